@@ -110,6 +110,13 @@
 #define configUSE_CORE_AFFINITY                 1
 #endif
 
+#ifdef ANJAY_PICO_HOST_BUILD
+/* FreeRTOS POSIX port: each task is backed by a pthread, whose stack cannot be
+ * smaller than PTHREAD_STACK_MIN */
+#undef configMINIMAL_STACK_SIZE
+#define configMINIMAL_STACK_SIZE                ( configSTACK_DEPTH_TYPE ) 4096
+#endif
+
 /* RP2040 specific */
 #define configSUPPORT_PICO_SYNC_INTEROP         1
 #define configSUPPORT_PICO_TIME_INTEROP         1
@@ -135,8 +135,13 @@
  * <c>#include AVS_COMMONS_POSIX_COMPAT_HEADER</c> statement. Thus, if editing
  * this file manually, <c>avsystem/commons/lwip-posix-compat.h</c> shall be
  * replaced with a path to such file.
+ *
+ * The host build (ANJAY_PICO_HOST_BUILD) uses native sockets instead of lwIP.
  */
-#define AVS_COMMONS_POSIX_COMPAT_HEADER "avsystem/commons/lwip-posix-compat.h"
+#ifndef ANJAY_PICO_HOST_BUILD
+#    define AVS_COMMONS_POSIX_COMPAT_HEADER \
+            "avsystem/commons/lwip-posix-compat.h"
+#endif // ANJAY_PICO_HOST_BUILD
 
 /**
  * Set if printf implementation doesn't support 64-bit format specifiers.
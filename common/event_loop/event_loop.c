@@ -0,0 +1,153 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/sockets.h"
+#include <anjay/anjay.h>
+#include <avsystem/commons/avs_list.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_socket.h>
+
+#include "event_loop.h"
+
+typedef struct {
+    avs_net_socket_t *sockets[EVENT_LOOP_MAX_SOCKETS];
+    struct pollfd pollfds[EVENT_LOOP_MAX_SOCKETS];
+    size_t numsocks;
+} pollfd_cache_t;
+
+static pollfd_cache_t g_cache;
+static event_loop_stats_t g_stats;
+
+static bool pollfd_cache_matches(const pollfd_cache_t *cache,
+                                 AVS_LIST(avs_net_socket_t *const) sockets) {
+    size_t i = 0;
+    AVS_LIST(avs_net_socket_t *const) sock;
+    AVS_LIST_FOREACH(sock, sockets) {
+        if (i >= cache->numsocks || cache->sockets[i] != *sock) {
+            return false;
+        }
+        ++i;
+    }
+    return i == cache->numsocks;
+}
+
+static void pollfd_cache_rebuild(pollfd_cache_t *cache,
+                                 AVS_LIST(avs_net_socket_t *const) sockets) {
+    size_t i = 0;
+    AVS_LIST(avs_net_socket_t *const) sock;
+    AVS_LIST_FOREACH(sock, sockets) {
+        if (i >= EVENT_LOOP_MAX_SOCKETS) {
+            avs_log(event_loop, WARNING,
+                    "More than %d sockets, the remaining ones are not polled",
+                    EVENT_LOOP_MAX_SOCKETS);
+            break;
+        }
+        cache->sockets[i] = *sock;
+        cache->pollfds[i].events = POLLIN;
+        ++i;
+    }
+    cache->numsocks = i;
+}
+
+static void pollfd_cache_refresh(pollfd_cache_t *cache,
+                                 AVS_LIST(avs_net_socket_t *const) sockets) {
+    if (!pollfd_cache_matches(cache, sockets)) {
+        pollfd_cache_rebuild(cache, sockets);
+        ++g_stats.pollfd_rebuilds;
+    }
+    // the descriptor is queried on every iteration, as a socket may replace
+    // its underlying system socket (and the storage it is returned from) when
+    // it reconnects; poll() ignores negative descriptors
+    for (size_t i = 0; i < cache->numsocks; ++i) {
+        const int *fd_ptr =
+                (const int *) avs_net_socket_get_system(cache->sockets[i]);
+        cache->pollfds[i].fd = fd_ptr ? *fd_ptr : -1;
+        cache->pollfds[i].revents = 0;
+    }
+}
+
+static void update_stats(uint64_t busy_us, uint64_t poll_wait_us) {
+    const uint32_t busy_us_32 =
+            busy_us > UINT32_MAX ? UINT32_MAX : (uint32_t) busy_us;
+
+    taskENTER_CRITICAL();
+    ++g_stats.iterations;
+    g_stats.busy_us += busy_us;
+    g_stats.poll_wait_us += poll_wait_us;
+    g_stats.last_busy_us = busy_us_32;
+    if (busy_us_32 > g_stats.max_busy_us) {
+        g_stats.max_busy_us = busy_us_32;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void event_loop_run(anjay_t *anjay) {
+    assert(anjay);
+
+    uint64_t iteration_start_us = time_us_64();
+    while (true) {
+        pollfd_cache_refresh(&g_cache, anjay_get_sockets(anjay));
+
+        const int wait_ms =
+                anjay_sched_calculate_wait_time_ms(anjay,
+                                                   EVENT_LOOP_MAX_WAIT_TIME_MS);
+
+        const uint64_t poll_start_us = time_us_64();
+        const int ready = poll(g_cache.pollfds, g_cache.numsocks, wait_ms);
+        const uint64_t poll_end_us = time_us_64();
+
+        if (ready > 0) {
+            for (size_t i = 0; i < g_cache.numsocks; ++i) {
+                if (g_cache.pollfds[i].revents) {
+                    ++g_stats.sockets_served;
+                    if (anjay_serve(anjay, g_cache.sockets[i])) {
+                        avs_log(event_loop, ERROR, "anjay_serve() failed");
+                    }
+                }
+            }
+        }
+
+        anjay_sched_run(anjay);
+
+        const uint64_t iteration_end_us = time_us_64();
+        update_stats((poll_start_us - iteration_start_us)
+                             + (iteration_end_us - poll_end_us),
+                     poll_end_us - poll_start_us);
+        iteration_start_us = iteration_end_us;
+    }
+}
+
+void event_loop_get_stats(event_loop_stats_t *out_stats) {
+    taskENTER_CRITICAL();
+    *out_stats = g_stats;
+    taskEXIT_CRITICAL();
+}
+
+void event_loop_reset_stats(void) {
+    taskENTER_CRITICAL();
+    memset(&g_stats, 0, sizeof(g_stats));
+    taskEXIT_CRITICAL();
+}
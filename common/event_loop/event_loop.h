@@ -0,0 +1,69 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <anjay/core.h>
+
+/**
+ * Upper bound for the time spent in a single poll() call, so that the loop
+ * periodically re-checks the Anjay socket list.
+ */
+#define EVENT_LOOP_MAX_WAIT_TIME_MS 1000
+
+/**
+ * Number of sockets the cached pollfd array can hold. A basic client uses one
+ * socket per server, plus one for an ongoing CoAP download.
+ */
+#ifndef EVENT_LOOP_MAX_SOCKETS
+#    define EVENT_LOOP_MAX_SOCKETS 4
+#endif
+
+typedef struct {
+    /* Number of completed loop iterations */
+    uint32_t iterations;
+    /* Number of times the pollfd array had to be rebuilt */
+    uint32_t pollfd_rebuilds;
+    /* Number of anjay_serve() calls */
+    uint32_t sockets_served;
+    /* Total time spent blocked in poll() */
+    uint64_t poll_wait_us;
+    /* Total time spent outside poll(): serving sockets and running jobs */
+    uint64_t busy_us;
+    /* Time spent outside poll() in the most recent iteration */
+    uint32_t last_busy_us;
+    /* Longest time spent outside poll() in a single iteration */
+    uint32_t max_busy_us;
+} event_loop_stats_t;
+
+/**
+ * Runs the Anjay event loop forever: waits for incoming packets on the Anjay
+ * sockets and runs scheduled jobs when they are due.
+ *
+ * The pollfd array is cached between iterations and only rebuilt when the set
+ * of sockets returned by anjay_get_sockets() changes; the descriptors are
+ * still re-read from the sockets every iteration.
+ */
+void event_loop_run(anjay_t *anjay);
+
+/**
+ * Copies the per-iteration timing counters. Safe to call from any task.
+ */
+void event_loop_get_stats(event_loop_stats_t *out_stats);
+
+void event_loop_reset_stats(void);
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+
+#include "pico/cyw43_arch.h"
+#include "pico/stdlib.h"
+
+#include <anjay/core.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_sched.h>
+
+#include "wifi_link.h"
+
+static anjay_t *link_anjay;
+static const char *link_ssid;
+static const char *link_password;
+static avs_sched_handle_t check_job;
+static bool offline;
+/* time_us_64() at which the last connection attempt was started, 0 if none
+ * has been started since the link went down */
+static uint64_t attempt_started_us;
+
+static void schedule_check(void);
+
+static void check_link(avs_sched_t *sched, const void *unused) {
+    (void) sched;
+    (void) unused;
+
+    const int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    if (status == CYW43_LINK_UP) {
+        if (offline) {
+            avs_log(wifi_link, INFO, "Wi-Fi link restored");
+            anjay_transport_exit_offline(link_anjay, ANJAY_TRANSPORT_SET_ALL);
+            offline = false;
+        }
+    } else {
+        if (!offline) {
+            avs_log(wifi_link, WARNING, "Wi-Fi link lost, status: %d",
+                    status);
+            anjay_transport_enter_offline(link_anjay, ANJAY_TRANSPORT_SET_ALL);
+            offline = true;
+            attempt_started_us = 0;
+        }
+        // negative statuses mean that the last attempt has failed
+        const uint64_t now_us = time_us_64();
+        if (status < CYW43_LINK_DOWN || !attempt_started_us
+                || now_us - attempt_started_us
+                           >= (uint64_t) WIFI_LINK_CONNECT_TIMEOUT_MS * 1000) {
+            if (cyw43_arch_wifi_connect_async(link_ssid, link_password,
+                                              CYW43_AUTH_WPA2_AES_PSK)) {
+                avs_log(wifi_link, WARNING, "Could not start joining %s",
+                        link_ssid);
+            } else {
+                attempt_started_us = now_us;
+            }
+        }
+    }
+    schedule_check();
+}
+
+static void schedule_check(void) {
+    if (AVS_SCHED_DELAYED(anjay_get_scheduler(link_anjay), &check_job,
+                          avs_time_duration_from_scalar(
+                                  WIFI_LINK_CHECK_PERIOD_MS, AVS_TIME_MS),
+                          check_link, NULL, 0)) {
+        avs_log(wifi_link, ERROR, "Could not schedule link check");
+    }
+}
+
+int wifi_link_monitor_start(anjay_t *anjay,
+                            const char *ssid,
+                            const char *password) {
+    assert(anjay);
+    assert(ssid);
+    assert(password);
+
+    link_anjay = anjay;
+    link_ssid = ssid;
+    link_password = password;
+    offline = false;
+    schedule_check();
+    return check_job ? 0 : -1;
+}
+
+void wifi_link_monitor_stop(void) {
+    if (link_anjay) {
+        avs_sched_del(&check_job);
+        link_anjay = NULL;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <anjay/core.h>
+
+/**
+ * Keeps the Wi-Fi station connected after the initial connection. A job on
+ * the Anjay scheduler checks the link every WIFI_LINK_CHECK_PERIOD_MS. When
+ * the link goes down, Anjay enters offline mode, so that it does not retry
+ * transmissions that cannot succeed, and the station rejoins the network in
+ * the background; an attempt that has not succeeded after
+ * WIFI_LINK_CONNECT_TIMEOUT_MS is restarted. Once the link is up again, Anjay
+ * exits offline mode, which reconnects to the servers.
+ */
+
+#ifndef WIFI_LINK_CHECK_PERIOD_MS
+#    define WIFI_LINK_CHECK_PERIOD_MS 5000
+#endif
+
+#ifndef WIFI_LINK_CONNECT_TIMEOUT_MS
+#    define WIFI_LINK_CONNECT_TIMEOUT_MS 30000
+#endif
+
+/**
+ * Starts monitoring the link. ssid and password must stay valid until
+ * wifi_link_monitor_stop() is called.
+ */
+int wifi_link_monitor_start(anjay_t *anjay,
+                            const char *ssid,
+                            const char *password);
+
+void wifi_link_monitor_stop(void);
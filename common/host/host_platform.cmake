@@ -0,0 +1,75 @@
+# Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Host (Linux) stand-ins for the parts of the Raspberry Pi Pico SDK used by the
+# examples. Included by the top-level CMakeLists.txt instead of
+# pico_sdk_import.cmake when ANJAY_PICO_HOST_BUILD is enabled.
+
+set(ANJAY_PICO_HOST_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+find_package(Threads REQUIRED)
+
+function(pico_sdk_init)
+endfunction()
+
+function(pico_enable_stdio_usb target enabled)
+endfunction()
+
+function(pico_enable_stdio_uart target enabled)
+endfunction()
+
+function(pico_add_extra_outputs target)
+endfunction()
+
+function(pfb_compile_with_bootloader target)
+endfunction()
+
+# Defines the pico-host library and the Pico SDK library names the examples
+# link against. Must be called after the FreeRTOS and mbedtls targets exist.
+function(anjay_pico_host_add_libraries)
+    file(GLOB PICO_HOST_SOURCES ${ANJAY_PICO_HOST_DIR}/src/*.c)
+
+    add_library(pico-host ${PICO_HOST_SOURCES})
+
+    target_include_directories(pico-host PUBLIC
+                               ${ANJAY_PICO_HOST_DIR}/include
+                               )
+
+    target_compile_definitions(pico-host PRIVATE
+                               MBEDTLS_CONFIG_FILE=\"${MBEDTLS_CONFIG_FILE}\"
+                               )
+
+    target_link_libraries(pico-host
+                          FreeRTOS
+                          mbedtls
+                          Threads::Threads
+                          )
+
+    foreach(PICO_LIB pico_stdlib
+                     pico_cyw43_arch_lwip_sys_freertos
+                     pico_flash
+                     pico_fota_bootloader_lib
+                     hardware_adc
+                     hardware_dma
+                     hardware_flash
+                     hardware_gpio
+                     hardware_i2c
+                     hardware_irq
+                     hardware_pio
+                     hardware_sync
+                     hardware_timer)
+        add_library(${PICO_LIB} INTERFACE)
+        target_link_libraries(${PICO_LIB} INTERFACE pico-host)
+    endforeach()
+endfunction()
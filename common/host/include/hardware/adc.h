@@ -0,0 +1,39 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for hardware_adc. Conversion results come from a source
+ * callback registered with host_adc_set_source(); without one, every channel
+ * reads as mid-scale.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico.h"
+
+typedef uint16_t host_adc_source_t(uint input, void *arg);
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint adc_get_selected_input(void);
+void adc_set_temp_sensor_enabled(bool enable);
+uint16_t adc_read(void);
+
+void host_adc_set_source(host_adc_source_t *source, void *arg);
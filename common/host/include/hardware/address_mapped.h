@@ -0,0 +1,36 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for the register access helpers of the Pico SDK. The atomic
+ * set and clear aliases of the peripherals become atomic read-modify-write
+ * operations on plain memory.
+ */
+
+#include <stdint.h>
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+
+static inline void hw_set_bits(io_rw_32 *addr, uint32_t mask) {
+    __atomic_fetch_or(addr, mask, __ATOMIC_SEQ_CST);
+}
+
+static inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask) {
+    __atomic_fetch_and(addr, ~mask, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for hardware_flash. The flash array lives in RAM and has NOR
+ * semantics: erase sets whole sectors to 0xFF and programming can only clear
+ * bits. If the ANJAY_PICO_HOST_FLASH_FILE environment variable is set, the
+ * contents are loaded from and written back to that file.
+ *
+ * Erases are counted per sector, and the time the operations would take on
+ * the real flash is accumulated from the typical figures of the W25Q16JV on
+ * the Pico W, so that wear and throughput can be measured on the host.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_BLOCK_SIZE (1u << 16)
+
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+#define XIP_BASE ((uintptr_t) host_flash_memory())
+
+/* Typical W25Q16JV timings */
+#define HOST_FLASH_SECTOR_ERASE_US 45000
+#define HOST_FLASH_PAGE_PROGRAM_US 400
+
+typedef struct {
+    uint32_t sector_erases;
+    uint32_t pages_programmed;
+    /* Time the operations above would take on the device */
+    uint64_t busy_us;
+} host_flash_stats_t;
+
+const uint8_t *host_flash_memory(void);
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs,
+                         const uint8_t *data,
+                         size_t count);
+
+void host_flash_get_stats(host_flash_stats_t *out_stats);
+
+/**
+ * Returns the number of times the sector containing flash_offs has been erased
+ * since the start of the process.
+ */
+uint32_t host_flash_get_erase_count(uint32_t flash_offs);
+
+/**
+ * Makes the next programming of the byte at flash_offs fail: the byte keeps
+ * the value it had before, while the rest of the range is programmed.
+ */
+void host_flash_inject_program_error(uint32_t flash_offs);
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for hardware_i2c. Transfers are routed to simulated devices
+ * attached with host_i2c_attach(); addressing a missing device fails the same
+ * way a NACK does on the real bus.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t *const i2c0;
+extern i2c_inst_t *const i2c1;
+
+#define i2c_default i2c0
+
+typedef struct {
+    int (*write)(void *arg, const uint8_t *src, size_t len, bool nostop);
+    int (*read)(void *arg, uint8_t *dst, size_t len, bool nostop);
+} host_i2c_device_t;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+int i2c_write_blocking(i2c_inst_t *i2c,
+                       uint8_t addr,
+                       const uint8_t *src,
+                       size_t len,
+                       bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c,
+                      uint8_t addr,
+                      uint8_t *dst,
+                      size_t len,
+                      bool nostop);
+
+int host_i2c_attach(i2c_inst_t *i2c,
+                    uint8_t addr,
+                    const host_i2c_device_t *device,
+                    void *arg);
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for the IO_BANK0 interrupt registers. Each core has its own
+ * set of enable bits, four per GPIO (see enum gpio_irq_level), which the host
+ * GPIO stand-in honours when an input is driven.
+ */
+
+#include "hardware/address_mapped.h"
+
+typedef struct {
+    io_rw_32 inte[4];
+    io_rw_32 intf[4];
+    io_ro_32 ints[4];
+} io_irq_ctrl_hw_t;
+
+typedef struct {
+    io_irq_ctrl_hw_t proc0_irq_ctrl;
+    io_irq_ctrl_hw_t proc1_irq_ctrl;
+} iobank0_hw_t;
+
+extern iobank0_hw_t host_iobank0_hw;
+
+#define iobank0_hw (&host_iobank0_hw)
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for the ROSC register block. Every read of
+ * rosc_hw->randombit yields a fresh bit from the host entropy source.
+ */
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t randombit;
+} rosc_hw_t;
+
+uint32_t host_rosc_randombit(void);
+
+#define rosc_hw (&(const rosc_hw_t) { .randombit = host_rosc_randombit() })
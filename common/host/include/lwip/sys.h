@@ -0,0 +1,29 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for lwip/sys.h. Only sys_now() is needed by the compat layer;
+ * it reports the FreeRTOS tick count in milliseconds, like the lwIP
+ * sys_arch port used on the device.
+ */
+
+#include <stdint.h>
+
+typedef uint32_t u32_t;
+
+u32_t sys_now(void);
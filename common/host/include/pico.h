@@ -0,0 +1,50 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for the Pico SDK base header: basic types, attributes and the
+ * pico_w board defaults the examples rely on.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#ifndef __unused
+#    define __unused __attribute__((unused))
+#endif
+
+#ifndef __not_in_flash_func
+#    define __not_in_flash_func(func_name) func_name
+#endif
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+#define PICO_DEFAULT_I2C 0
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+
+#define NUM_BANK0_GPIOS 30
+
+/* The host build runs everything as if on core 0 */
+static inline uint get_core_num(void) {
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for pico_cyw43_arch. The host is assumed to already have
+ * network connectivity, so "connecting" only reports the simulated link state,
+ * which can be changed with host_cyw43_set_link_up().
+ */
+
+#include <stdint.h>
+
+#include "pico.h"
+
+#define CYW43_AUTH_OPEN (0)
+#define CYW43_AUTH_WPA_TKIP_PSK (0x00200002)
+#define CYW43_AUTH_WPA2_AES_PSK (0x00400004)
+#define CYW43_AUTH_WPA2_MIXED_PSK (0x00400006)
+
+#define CYW43_ITF_STA (0)
+
+#define CYW43_LINK_DOWN (0)
+#define CYW43_LINK_JOIN (1)
+#define CYW43_LINK_NOIP (2)
+#define CYW43_LINK_UP (3)
+#define CYW43_LINK_FAIL (-1)
+#define CYW43_LINK_NONET (-2)
+#define CYW43_LINK_BADAUTH (-3)
+
+typedef struct {
+    int itf_state;
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid,
+                                       const char *pw,
+                                       uint32_t auth,
+                                       uint32_t timeout);
+int cyw43_arch_wifi_connect_async(const char *ssid,
+                                  const char *pw,
+                                  uint32_t auth);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+
+void host_cyw43_set_link_up(bool up);
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for pico_flash. Nothing else can execute from the simulated
+ * flash, so the function is simply called.
+ */
+
+#include <stdint.h>
+
+#include "pico.h"
+
+static inline int flash_safe_execute(void (*func)(void *),
+                                     void *param,
+                                     uint32_t enter_exit_timeout_ms) {
+    (void) enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
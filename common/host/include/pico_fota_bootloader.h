@@ -0,0 +1,46 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Host stand-in for pico_fota_bootloader. The download slot is a region of the
+ * simulated flash (see hardware/flash.h) and "performing the update" ends the
+ * process, as a reboot would.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PFB_ALIGN_SIZE 256
+
+/* Layout of the simulated flash, mirroring the pico_fota_bootloader one */
+#define PFB_HOST_APP_SLOT_OFFSET (40 * 1024)
+#define PFB_HOST_DOWNLOAD_SLOT_OFFSET (1044 * 1024)
+#define PFB_HOST_DOWNLOAD_SLOT_SIZE (1004 * 1024)
+
+void pfb_mark_download_slot_as_valid(void);
+void pfb_mark_download_slot_as_invalid(void);
+void pfb_initialize_download_slot(void);
+int pfb_write_to_flash_aligned_256_bytes(uint8_t *src,
+                                         size_t offset_bytes,
+                                         size_t len_bytes);
+void pfb_perform_update(void);
+void pfb_firmware_commit(void);
+bool pfb_is_after_firmware_update(void);
+bool pfb_is_after_rollback(void);
+int pfb_firmware_sha256_check(size_t firmware_size);
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hardware/adc.h"
+
+#define ADC_MID_SCALE (1u << 11)
+
+static uint selected_input;
+static host_adc_source_t *adc_source;
+static void *adc_source_arg;
+
+void adc_init(void) {
+    selected_input = 0;
+}
+
+void adc_gpio_init(uint gpio) {
+    (void) gpio;
+}
+
+void adc_select_input(uint input) {
+    selected_input = input;
+}
+
+uint adc_get_selected_input(void) {
+    return selected_input;
+}
+
+void adc_set_temp_sensor_enabled(bool enable) {
+    (void) enable;
+}
+
+uint16_t adc_read(void) {
+    if (!adc_source) {
+        return ADC_MID_SCALE;
+    }
+    // the real ADC is 12-bit
+    return adc_source(selected_input, adc_source_arg) & 0xFFFu;
+}
+
+void host_adc_set_source(host_adc_source_t *source, void *arg) {
+    adc_source = source;
+    adc_source_arg = arg;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pico/critical_section.h"
+
+void critical_section_init(critical_section_t *crit_sec) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&crit_sec->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void critical_section_enter_blocking(critical_section_t *crit_sec) {
+    pthread_mutex_lock(&crit_sec->mutex);
+}
+
+void critical_section_exit(critical_section_t *crit_sec) {
+    pthread_mutex_unlock(&crit_sec->mutex);
+}
+
+void critical_section_deinit(critical_section_t *crit_sec) {
+    pthread_mutex_destroy(&crit_sec->mutex);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pico/cyw43_arch.h"
+
+cyw43_t cyw43_state;
+
+static volatile bool link_up = true;
+
+int cyw43_arch_init(void) {
+    return 0;
+}
+
+void cyw43_arch_deinit(void) {
+}
+
+void cyw43_arch_enable_sta_mode(void) {
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid,
+                                       const char *pw,
+                                       uint32_t auth,
+                                       uint32_t timeout) {
+    (void) ssid;
+    (void) pw;
+    (void) auth;
+    (void) timeout;
+    return link_up ? 0 : PICO_ERROR_TIMEOUT;
+}
+
+int cyw43_arch_wifi_connect_async(const char *ssid,
+                                  const char *pw,
+                                  uint32_t auth) {
+    (void) ssid;
+    (void) pw;
+    (void) auth;
+    return 0;
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf) {
+    (void) self;
+    (void) itf;
+    return link_up ? CYW43_LINK_UP : CYW43_LINK_DOWN;
+}
+
+void host_cyw43_set_link_up(bool up) {
+    link_up = up;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+
+static uint8_t flash_memory[PICO_FLASH_SIZE_BYTES];
+static uint32_t erase_counts[PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE];
+static host_flash_stats_t flash_stats;
+static pthread_once_t flash_once = PTHREAD_ONCE_INIT;
+static const char *flash_file;
+static bool program_error_pending;
+static uint32_t program_error_offs;
+
+static void flash_sync(uint32_t flash_offs, size_t count) {
+    if (!flash_file) {
+        return;
+    }
+    FILE *f = fopen(flash_file, "r+b");
+    if (!f) {
+        f = fopen(flash_file, "w+b");
+    }
+    if (!f) {
+        return;
+    }
+    if (!fseek(f, (long) flash_offs, SEEK_SET)) {
+        fwrite(&flash_memory[flash_offs], 1, count, f);
+    }
+    fclose(f);
+}
+
+static void flash_load(void) {
+    memset(flash_memory, 0xFF, sizeof(flash_memory));
+    flash_file = getenv("ANJAY_PICO_HOST_FLASH_FILE");
+    if (!flash_file) {
+        return;
+    }
+    FILE *f = fopen(flash_file, "rb");
+    if (f) {
+        size_t read = fread(flash_memory, 1, sizeof(flash_memory), f);
+        (void) read;
+        fclose(f);
+    }
+}
+
+const uint8_t *host_flash_memory(void) {
+    pthread_once(&flash_once, flash_load);
+    return flash_memory;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    pthread_once(&flash_once, flash_load);
+    assert(flash_offs % FLASH_SECTOR_SIZE == 0);
+    assert(count % FLASH_SECTOR_SIZE == 0);
+    assert(flash_offs + count <= sizeof(flash_memory));
+    memset(&flash_memory[flash_offs], 0xFF, count);
+    for (size_t i = 0; i < count / FLASH_SECTOR_SIZE; i++) {
+        erase_counts[flash_offs / FLASH_SECTOR_SIZE + i]++;
+    }
+    flash_stats.sector_erases += (uint32_t) (count / FLASH_SECTOR_SIZE);
+    flash_stats.busy_us +=
+            (uint64_t) (count / FLASH_SECTOR_SIZE) * HOST_FLASH_SECTOR_ERASE_US;
+    flash_sync(flash_offs, count);
+}
+
+void flash_range_program(uint32_t flash_offs,
+                         const uint8_t *data,
+                         size_t count) {
+    pthread_once(&flash_once, flash_load);
+    assert(flash_offs % FLASH_PAGE_SIZE == 0);
+    assert(count % FLASH_PAGE_SIZE == 0);
+    assert(flash_offs + count <= sizeof(flash_memory));
+    // a byte left as it was, if an error has been injected into this range
+    const bool program_error = program_error_pending
+                               && program_error_offs >= flash_offs
+                               && program_error_offs < flash_offs + count;
+    const uint8_t unprogrammed =
+            program_error ? flash_memory[program_error_offs] : 0;
+    for (size_t i = 0; i < count; i++) {
+        // NOR flash programming can only clear bits
+        flash_memory[flash_offs + i] &= data[i];
+    }
+    if (program_error) {
+        flash_memory[program_error_offs] = unprogrammed;
+        program_error_pending = false;
+    }
+    flash_stats.pages_programmed += (uint32_t) (count / FLASH_PAGE_SIZE);
+    flash_stats.busy_us +=
+            (uint64_t) (count / FLASH_PAGE_SIZE) * HOST_FLASH_PAGE_PROGRAM_US;
+    flash_sync(flash_offs, count);
+}
+
+void host_flash_get_stats(host_flash_stats_t *out_stats) {
+    assert(out_stats);
+    *out_stats = flash_stats;
+}
+
+uint32_t host_flash_get_erase_count(uint32_t flash_offs) {
+    assert(flash_offs < sizeof(flash_memory));
+    return erase_counts[flash_offs / FLASH_SECTOR_SIZE];
+}
+
+void host_flash_inject_program_error(uint32_t flash_offs) {
+    assert(flash_offs < sizeof(flash_memory));
+    program_error_pending = true;
+    program_error_offs = flash_offs;
+}
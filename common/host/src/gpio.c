@@ -0,0 +1,133 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "hardware/gpio.h"
+#include "hardware/structs/iobank0.h"
+
+typedef struct {
+    bool out;
+    bool out_value;
+    bool in_driven;
+    bool in_value;
+    bool pull_up;
+} host_gpio_t;
+
+iobank0_hw_t host_iobank0_hw;
+
+static host_gpio_t gpios[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t irq_callback;
+
+static io_irq_ctrl_hw_t *irq_ctrl_of_core(uint core) {
+    return core ? &iobank0_hw->proc1_irq_ctrl : &iobank0_hw->proc0_irq_ctrl;
+}
+
+static uint32_t irq_enabled_events(uint core, uint gpio) {
+    return (irq_ctrl_of_core(core)->inte[gpio / 8] >> (4 * (gpio % 8))) & 0xF;
+}
+
+void gpio_init(uint gpio) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    gpios[gpio] = (host_gpio_t) { 0 };
+    for (uint core = 0; core < 2; core++) {
+        hw_clear_bits(&irq_ctrl_of_core(core)->inte[gpio / 8],
+                      0xFu << (4 * (gpio % 8)));
+    }
+}
+
+void gpio_deinit(uint gpio) {
+    gpio_init(gpio);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    (void) fn;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    gpios[gpio].out = out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    gpios[gpio].out_value = value;
+}
+
+bool gpio_get(uint gpio) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    const host_gpio_t *pin = &gpios[gpio];
+    if (pin->out) {
+        return pin->out_value;
+    }
+    return pin->in_driven ? pin->in_value : pin->pull_up;
+}
+
+void gpio_pull_up(uint gpio) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    gpios[gpio].pull_up = true;
+}
+
+void gpio_pull_down(uint gpio) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    gpios[gpio].pull_up = false;
+}
+
+void gpio_disable_pulls(uint gpio) {
+    gpio_pull_down(gpio);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    // like on the device, only the enable bits of the calling core change
+    io_rw_32 *inte = &irq_ctrl_of_core(get_core_num())->inte[gpio / 8];
+    event_mask <<= 4 * (gpio % 8);
+    if (enabled) {
+        hw_set_bits(inte, event_mask);
+    } else {
+        hw_clear_bits(inte, event_mask);
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio,
+                                        uint32_t event_mask,
+                                        bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    irq_callback = callback;
+}
+
+void host_gpio_drive_input(uint gpio, bool value) {
+    assert(gpio < NUM_BANK0_GPIOS);
+    host_gpio_t *pin = &gpios[gpio];
+    const bool previous = gpio_get(gpio);
+    pin->in_driven = true;
+    pin->in_value = value;
+
+    uint32_t events = 0;
+    if (previous && !value) {
+        events |= GPIO_IRQ_EDGE_FALL;
+    } else if (!previous && value) {
+        events |= GPIO_IRQ_EDGE_RISE;
+    }
+    events |= value ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+    // the callback is registered on core 0, see get_core_num()
+    events &= irq_enabled_events(0, gpio);
+    if (events && irq_callback) {
+        irq_callback(gpio, events);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "hardware/i2c.h"
+
+#define HOST_I2C_MAX_DEVICES 8
+
+typedef struct {
+    uint8_t addr;
+    const host_i2c_device_t *device;
+    void *arg;
+} host_i2c_slot_t;
+
+struct i2c_inst {
+    bool initialized;
+    host_i2c_slot_t slots[HOST_I2C_MAX_DEVICES];
+};
+
+static struct i2c_inst i2c_instances[2];
+
+i2c_inst_t *const i2c0 = &i2c_instances[0];
+i2c_inst_t *const i2c1 = &i2c_instances[1];
+
+static host_i2c_slot_t *find_slot(i2c_inst_t *i2c, uint8_t addr) {
+    for (size_t i = 0; i < HOST_I2C_MAX_DEVICES; i++) {
+        if (i2c->slots[i].device && i2c->slots[i].addr == addr) {
+            return &i2c->slots[i];
+        }
+    }
+    return NULL;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->initialized = true;
+    return baudrate;
+}
+
+void i2c_deinit(i2c_inst_t *i2c) {
+    i2c->initialized = false;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c,
+                       uint8_t addr,
+                       const uint8_t *src,
+                       size_t len,
+                       bool nostop) {
+    host_i2c_slot_t *slot = find_slot(i2c, addr);
+    if (!i2c->initialized || !slot || !slot->device->write) {
+        return PICO_ERROR_GENERIC;
+    }
+    return slot->device->write(slot->arg, src, len, nostop);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c,
+                      uint8_t addr,
+                      uint8_t *dst,
+                      size_t len,
+                      bool nostop) {
+    host_i2c_slot_t *slot = find_slot(i2c, addr);
+    if (!i2c->initialized || !slot || !slot->device->read) {
+        return PICO_ERROR_GENERIC;
+    }
+    return slot->device->read(slot->arg, dst, len, nostop);
+}
+
+int host_i2c_attach(i2c_inst_t *i2c,
+                    uint8_t addr,
+                    const host_i2c_device_t *device,
+                    void *arg) {
+    assert(device);
+    if (find_slot(i2c, addr)) {
+        return -1;
+    }
+    for (size_t i = 0; i < HOST_I2C_MAX_DEVICES; i++) {
+        if (!i2c->slots[i].device) {
+            i2c->slots[i] = (host_i2c_slot_t) {
+                .addr = addr,
+                .device = device,
+                .arg = arg
+            };
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mbedtls/sha256.h>
+
+#include "hardware/flash.h"
+
+#include <pico_fota_bootloader.h>
+
+#define PFB_SHA256_DIGEST_SIZE 32
+
+static bool download_slot_valid;
+
+void pfb_mark_download_slot_as_valid(void) {
+    download_slot_valid = true;
+}
+
+void pfb_mark_download_slot_as_invalid(void) {
+    download_slot_valid = false;
+}
+
+void pfb_initialize_download_slot(void) {
+    pfb_mark_download_slot_as_invalid();
+    flash_range_erase(PFB_HOST_DOWNLOAD_SLOT_OFFSET,
+                      PFB_HOST_DOWNLOAD_SLOT_SIZE);
+}
+
+int pfb_write_to_flash_aligned_256_bytes(uint8_t *src,
+                                         size_t offset_bytes,
+                                         size_t len_bytes) {
+    if (offset_bytes % PFB_ALIGN_SIZE || len_bytes % PFB_ALIGN_SIZE
+            || offset_bytes + len_bytes > PFB_HOST_DOWNLOAD_SLOT_SIZE) {
+        return -1;
+    }
+    flash_range_program(PFB_HOST_DOWNLOAD_SLOT_OFFSET + offset_bytes, src,
+                        len_bytes);
+    return 0;
+}
+
+void pfb_perform_update(void) {
+    printf("pico_fota_bootloader: %s, exiting\n",
+           download_slot_valid ? "swapping to the downloaded image"
+                               : "no valid image, rebooting");
+    exit(0);
+}
+
+void pfb_firmware_commit(void) {
+}
+
+bool pfb_is_after_firmware_update(void) {
+    return false;
+}
+
+bool pfb_is_after_rollback(void) {
+    return false;
+}
+
+int pfb_firmware_sha256_check(size_t firmware_size) {
+    if (firmware_size < PFB_SHA256_DIGEST_SIZE
+            || firmware_size > PFB_HOST_DOWNLOAD_SLOT_SIZE) {
+        return -1;
+    }
+    // the SHA-256 of the image is appended to it by the build scripts
+    const uint8_t *slot = host_flash_memory() + PFB_HOST_DOWNLOAD_SLOT_OFFSET;
+    const size_t image_size = firmware_size - PFB_SHA256_DIGEST_SIZE;
+    uint8_t digest[PFB_SHA256_DIGEST_SIZE];
+    if (mbedtls_sha256_ret(slot, image_size, digest, 0)) {
+        return -1;
+    }
+    return memcmp(digest, slot + image_size, sizeof(digest)) ? -1 : 0;
+}
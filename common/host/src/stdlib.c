@@ -0,0 +1,79 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+static bool time_frozen;
+static uint64_t frozen_time_us;
+
+bool stdio_init_all(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+uint64_t time_us_64(void) {
+    if (time_frozen) {
+        return frozen_time_us;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t) time_us_64();
+}
+
+void sleep_us(uint64_t us) {
+    if (time_frozen) {
+        frozen_time_us += us;
+        return;
+    }
+    struct timespec ts = {
+        .tv_sec = (time_t) (us / 1000000u),
+        .tv_nsec = (long) (us % 1000000u) * 1000
+    };
+    // FreeRTOS POSIX port delivers its tick as a signal, so keep sleeping
+    // through interruptions
+    while (nanosleep(&ts, &ts) && errno == EINTR) {
+    }
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t) ms * 1000u);
+}
+
+void busy_wait_us(uint64_t us) {
+    if (time_frozen) {
+        frozen_time_us += us;
+        return;
+    }
+    const uint64_t deadline = time_us_64() + us;
+    while (time_us_64() < deadline) {
+    }
+}
+
+void host_time_freeze(uint64_t now_us) {
+    frozen_time_us = now_us;
+    time_frozen = true;
+}
+
+void host_time_advance_us(uint64_t us) {
+    frozen_time_us += us;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/random.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/structs/rosc.h"
+#include "hardware/watchdog.h"
+#include "lwip/sys.h"
+
+u32_t sys_now(void) {
+    return (u32_t) (xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+uint32_t host_rosc_randombit(void) {
+    uint8_t byte = 0;
+    if (getrandom(&byte, sizeof(byte), 0) != sizeof(byte)) {
+        byte = (uint8_t) rand();
+    }
+    return byte & 1u;
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms) {
+    (void) pc;
+    (void) sp;
+    (void) delay_ms;
+    printf("Watchdog reboot requested, exiting\n");
+    exit(0);
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) {
+    (void) delay_ms;
+    (void) pause_on_debug;
+}
+
+void watchdog_update(void) {
+}
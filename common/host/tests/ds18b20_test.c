@@ -0,0 +1,187 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Drives the DS18B20 conversion state machine against the simulated 1-Wire
+ * bus, with the clock frozen so that the conversion time only passes when the
+ * test advances it */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "ds18b20.h"
+#include "host_test.h"
+#include "onewire_sim.h"
+
+#define SENSOR_COUNT 2
+
+/* Values representable at every resolution, so that they read back exactly */
+static const int32_t TEMPERATURES_MC[SENSOR_COUNT] = { 21500, -10000 };
+
+static onewire_sim_stats_t get_stats(void) {
+    onewire_sim_stats_t stats;
+    onewire_sim_get_stats(&stats);
+    return stats;
+}
+
+static void wait_for_conversion_ms(uint32_t conversion_ms) {
+    host_time_advance_us((uint64_t) conversion_ms * 1000 - 1000);
+    const onewire_sim_stats_t before = get_stats();
+    HOST_TEST_ASSERT(ds18b20_process() == 0);
+    // polling the busy status must neither read the results nor restart the
+    // conversion
+    const onewire_sim_stats_t after = get_stats();
+    HOST_TEST_ASSERT(after.scratchpad_reads == before.scratchpad_reads);
+    HOST_TEST_ASSERT(after.conversions == before.conversions);
+    host_time_advance_us(1000);
+}
+
+static void wait_for_conversion(void) {
+    wait_for_conversion_ms(ds18b20_get_conversion_time_ms());
+}
+
+static void check_value(size_t index, int expected_result) {
+    int32_t value;
+    HOST_TEST_ASSERT(temperature_get_data(index, &value) == expected_result);
+    if (!expected_result) {
+        HOST_TEST_ASSERT(value == TEMPERATURES_MC[index]);
+    }
+}
+
+static void test_conversion_schedule(void) {
+    // ds18b20_init() has configured the resolution, which reads the
+    // scratchpads for TH and TL, and started the first conversion on both
+    // sensors
+    onewire_sim_stats_t stats = get_stats();
+    HOST_TEST_ASSERT(stats.conversions == SENSOR_COUNT);
+    HOST_TEST_ASSERT(stats.scratchpad_reads == SENSOR_COUNT);
+    check_value(0, -1);
+
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    // both results are read, then the next conversion starts right away
+    stats = get_stats();
+    HOST_TEST_ASSERT(stats.scratchpad_reads == 2 * SENSOR_COUNT);
+    HOST_TEST_ASSERT(stats.conversions == 2 * SENSOR_COUNT);
+    check_value(0, 0);
+    check_value(1, 0);
+
+    // a new resolution is written before the next conversion, which then
+    // takes the shorter time
+    const uint32_t conversion_ms = ds18b20_get_conversion_time_ms();
+    HOST_TEST_ASSERT(conversion_ms == 750);
+    HOST_TEST_ASSERT(!ds18b20_set_resolution(9));
+    wait_for_conversion_ms(conversion_ms);
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    HOST_TEST_ASSERT(ds18b20_get_conversion_time_ms() == 94);
+    wait_for_conversion();
+    stats = get_stats();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    HOST_TEST_ASSERT(get_stats().scratchpad_reads
+                     == stats.scratchpad_reads + SENSOR_COUNT);
+    check_value(0, 0);
+    check_value(1, 0);
+
+    // a result left uncollected for too long is not read, the conversion is
+    // repeated instead
+    host_time_advance_us(11000000);
+    stats = get_stats();
+    HOST_TEST_ASSERT(ds18b20_process() == 0);
+    HOST_TEST_ASSERT(get_stats().scratchpad_reads == stats.scratchpad_reads);
+    HOST_TEST_ASSERT(get_stats().conversions
+                     == stats.conversions + SENSOR_COUNT);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+}
+
+static void test_getters_do_not_touch_bus(void) {
+    const onewire_sim_stats_t before = get_stats();
+    for (int i = 0; i < 1000; i++) {
+        int32_t value;
+        temperature_get_data((size_t) i % (SENSOR_COUNT + 1), &value);
+        ds18b20_get_rom_code((size_t) i % SENSOR_COUNT);
+        ds18b20_get_sensor_count();
+        ds18b20_get_resolution();
+        ds18b20_get_conversion_time_ms();
+    }
+    HOST_TEST_ASSERT(!ds18b20_set_resolution(ds18b20_get_resolution()));
+    const onewire_sim_stats_t after = get_stats();
+    HOST_TEST_ASSERT(!memcmp(&before, &after, sizeof(before)));
+}
+
+static void test_crc_error(void) {
+    // the result of a sensor with a broken scratchpad is an error, while the
+    // other one still gets a new sample
+    onewire_sim_set_crc_error(1, true);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    check_value(0, 0);
+    check_value(1, -1);
+
+    onewire_sim_set_crc_error(0, true);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() < 0);
+    check_value(0, -1);
+    check_value(1, -1);
+
+    onewire_sim_set_crc_error(0, false);
+    onewire_sim_set_crc_error(1, false);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    check_value(0, 0);
+    check_value(1, 0);
+}
+
+static void test_missing_device(void) {
+    onewire_sim_set_present(1, false);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    check_value(0, 0);
+    check_value(1, -1);
+
+    // with no presence pulse at all, nothing can be read and no conversion
+    // can be started either; the idle bus reads as ready, so the results are
+    // collected right away
+    onewire_sim_set_present(0, false);
+    HOST_TEST_ASSERT(ds18b20_process() < 0);
+    check_value(0, -1);
+    HOST_TEST_ASSERT(ds18b20_process() < 0);
+
+    onewire_sim_set_present(0, true);
+    onewire_sim_set_present(1, true);
+    HOST_TEST_ASSERT(ds18b20_process() == 0);
+    wait_for_conversion();
+    HOST_TEST_ASSERT(ds18b20_process() == 1);
+    check_value(0, 0);
+    check_value(1, 0);
+}
+
+int main(void) {
+    host_time_freeze(1000000);
+    for (size_t i = 0; i < SENSOR_COUNT; i++) {
+        HOST_TEST_ASSERT(onewire_sim_add_ds18b20(0x100 + i, TEMPERATURES_MC[i])
+                         == (int) i);
+    }
+    HOST_TEST_ASSERT(!ds18b20_init());
+    HOST_TEST_ASSERT(ds18b20_get_sensor_count() == SENSOR_COUNT);
+
+    test_conversion_schedule();
+    test_getters_do_not_touch_bus();
+    test_crc_error();
+    test_missing_device();
+    return 0;
+}
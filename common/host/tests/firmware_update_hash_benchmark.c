@@ -0,0 +1,114 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Time the Anjay task spends on the SHA-256 check of a firmware image filling
+ * the download slot (1004 KiB with the appended digest), in the two ways
+ * firmware_update.c could do it:
+ *
+ * - read-back: after the last block, pfb_firmware_sha256_check() hashes the
+ *   whole image again from flash, so Write /5/0 is answered only after it;
+ * - incremental: each block is hashed as it is received, as fw_stream_write()
+ *   does, and finishing only finalizes the hash.
+ *
+ * The total hashing work is the same; what differs is the stall after the
+ * last block, which the incremental variant spreads over the download. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <mbedtls/sha256.h>
+
+#include "hardware/flash.h"
+#include "pico/stdlib.h"
+
+#include <pico_fota_bootloader.h>
+
+#include "host_test.h"
+
+#define ITERATIONS 10
+#define BLOCK_SIZE 1024
+#define DIGEST_SIZE 32
+#define IMAGE_SIZE PFB_HOST_DOWNLOAD_SLOT_SIZE
+#define BODY_SIZE (IMAGE_SIZE - DIGEST_SIZE)
+
+static uint8_t image[IMAGE_SIZE];
+
+static void make_image(void) {
+    uint32_t seed = 0x5eed1234;
+    for (size_t i = 0; i < BODY_SIZE; i += sizeof(uint32_t)) {
+        const uint32_t word = host_test_rand(&seed);
+        memcpy(&image[i], &word, sizeof(word));
+    }
+    HOST_TEST_ASSERT(!mbedtls_sha256_ret(image, BODY_SIZE, &image[BODY_SIZE],
+                                         0));
+}
+
+static void write_image(void) {
+    pfb_initialize_download_slot();
+    HOST_TEST_ASSERT(!pfb_write_to_flash_aligned_256_bytes(image, 0,
+                                                           IMAGE_SIZE));
+}
+
+static void run_read_back(void) {
+    uint64_t finish_us = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        write_image();
+        const uint64_t start_us = time_us_64();
+        HOST_TEST_ASSERT(!pfb_firmware_sha256_check(IMAGE_SIZE));
+        finish_us += time_us_64() - start_us;
+    }
+    host_benchmark_report("read-back, finish", finish_us, ITERATIONS,
+                          "image");
+}
+
+static void run_incremental(void) {
+    uint64_t blocks_us = 0;
+    uint64_t finish_us = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        mbedtls_sha256_context sha256;
+        mbedtls_sha256_init(&sha256);
+        HOST_TEST_ASSERT(!mbedtls_sha256_starts_ret(&sha256, 0));
+        // the digest is only known to be the trailer once no more data comes
+        for (size_t offset = 0; offset < BODY_SIZE; offset += BLOCK_SIZE) {
+            const size_t len = BODY_SIZE - offset < BLOCK_SIZE
+                                       ? BODY_SIZE - offset
+                                       : BLOCK_SIZE;
+            const uint64_t start_us = time_us_64();
+            HOST_TEST_ASSERT(!mbedtls_sha256_update_ret(&sha256,
+                                                        &image[offset], len));
+            blocks_us += time_us_64() - start_us;
+        }
+
+        uint8_t digest[DIGEST_SIZE];
+        const uint64_t start_us = time_us_64();
+        HOST_TEST_ASSERT(!mbedtls_sha256_finish_ret(&sha256, digest));
+        HOST_TEST_ASSERT(!memcmp(digest, &image[BODY_SIZE], DIGEST_SIZE));
+        finish_us += time_us_64() - start_us;
+        mbedtls_sha256_free(&sha256);
+    }
+    host_benchmark_report("incremental, blocks", blocks_us,
+                          ITERATIONS * (uint64_t) (BODY_SIZE / BLOCK_SIZE + 1),
+                          "block");
+    host_benchmark_report("incremental, finish", finish_us, ITERATIONS,
+                          "image");
+}
+
+int main(void) {
+    make_image();
+    run_read_back();
+    run_incremental();
+    return 0;
+}
@@ -0,0 +1,426 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Resumption of firmware downloads across restarts. Every boot runs in a
+ * forked process sharing the simulated flash through a file: the download is
+ * cut at random offsets by a connection loss or a transport error, with the
+ * Wi-Fi link down or up (Anjay resets the download either way), the process
+ * exits as the device would restart, and the next boot resumes it from the
+ * offset Anjay is given, or starts it over if no checkpoint has been saved
+ * before the cut. Once complete, the download slot must hold the image and
+ * its digest. Packages that fail the SHA-256 check or are not
+ * pico_fota_bootloader images must not be resumed, even if the link is down
+ * when the download is reset. A page that fails to program must fail the
+ * download, which is then resumed from the last checkpoint.
+ *
+ * Each boot also checks that the download slot is erased lazily: no sector is
+ * erased when the download starts, and each one is erased once, only after
+ * data has been received for it. The first boot of every round fills the
+ * slot with a stale image of zeros, so the image only ends up in the slot if
+ * every sector is erased before it is first programmed.
+ *
+ * The test stands in for Anjay: it provides anjay_fw_update_install(), which
+ * records the handlers and the initial state, and calls the handlers the way
+ * the Anjay downloader does. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <anjay/anjay.h>
+#include <anjay/fw_update.h>
+
+#include <mbedtls/sha256.h>
+
+#include <pico_fota_bootloader.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/flash.h"
+#include "pico/cyw43_arch.h"
+
+#include "firmware_update.h"
+#include "host_test.h"
+
+#define ROUNDS 15
+#define MAX_CUTS 3
+#define DIGEST_SIZE 32
+#define IMAGE_MAX_SIZE (384 * 1024)
+#define PACKAGE_URI "coap://example.com/firmware.bin"
+#define BOOT_TASK_SIZE (configMINIMAL_STACK_SIZE * 4)
+/* The last sector of the slot holds the checkpoints */
+#define IMAGE_SECTORS (PFB_HOST_DOWNLOAD_SLOT_SIZE / FLASH_SECTOR_SIZE - 1)
+
+/* Exit status of a boot that has resumed the download; failed checks exit
+ * with 1 */
+#define EXIT_RESUMED 2
+
+typedef enum {
+    // the download completes after being cut by connection losses
+    OUTCOME_COMPLETE,
+    // a transport error cuts the download in CoAP blocks while the link is
+    // up, and the next boot resumes it from the last sector boundary before
+    // the cut and completes it
+    OUTCOME_TRANSPORT_ERROR,
+    // the last boot receives an image with a wrong digest, and the link goes
+    // down right after that
+    OUTCOME_CORRUPTED,
+    // the last boot receives an image followed by a few more bytes, which is
+    // not a pico_fota_bootloader image, and the link goes down right after
+    // that
+    OUTCOME_UNSUPPORTED,
+    // programming fails past the last cut, the link goes down right after
+    // that, and the next boot completes the download
+    OUTCOME_PROGRAM_ERROR
+} outcome_t;
+
+/* With room for trailing data past the largest image */
+static uint8_t image[IMAGE_MAX_SIZE + PFB_ALIGN_SIZE];
+static size_t image_size;
+
+static union {
+    anjay_etag_t etag;
+    uint8_t storage[sizeof(anjay_etag_t) + 4];
+} package_etag;
+
+/* What the boot forked next is to do: unless check_only is set, download up
+ * to cut_offset (from scratch if fresh, otherwise from a resume offset
+ * between resume_min and resume_max), then finish if the image is complete,
+ * expecting finish_result, and reset the download with the link down or up
+ * unless it has succeeded. If program_error is set, programming the byte at
+ * program_error_offset fails, which must stop the download there. */
+static struct {
+    bool check_only;
+    bool fresh;
+    size_t resume_min;
+    size_t resume_max;
+    size_t cut_offset;
+    bool program_error;
+    size_t program_error_offset;
+    int finish_result;
+    bool link_up_on_reset;
+    uint32_t seed;
+} boot;
+
+static bool resumed;
+/* Erase counts of the sectors of the image area at the start of the boot */
+static uint32_t boot_erase_counts[IMAGE_SECTORS];
+static const anjay_fw_update_handlers_t *handlers;
+static void *handlers_arg;
+static anjay_fw_update_initial_state_t initial_state;
+
+int anjay_fw_update_install(anjay_t *anjay,
+                            const anjay_fw_update_handlers_t *fw_handlers,
+                            void *user_arg,
+                            const anjay_fw_update_initial_state_t *state) {
+    (void) anjay;
+    handlers = fw_handlers;
+    handlers_arg = user_arg;
+    initial_state = *state;
+    return 0;
+}
+
+static size_t start_download(void) {
+    if (initial_state.result != ANJAY_FW_UPDATE_INITIAL_DOWNLOADING) {
+        HOST_TEST_ASSERT(!boot.resume_min);
+        HOST_TEST_ASSERT(!handlers->stream_open(handlers_arg, PACKAGE_URI,
+                                                &package_etag.etag));
+        return 0;
+    }
+
+    // resumed from the last checkpoint saved before the previous cut
+    HOST_TEST_ASSERT(!boot.fresh);
+    resumed = true;
+    HOST_TEST_ASSERT(initial_state.result
+                     == ANJAY_FW_UPDATE_INITIAL_DOWNLOADING);
+    HOST_TEST_ASSERT(!strcmp(initial_state.persisted_uri, PACKAGE_URI));
+    HOST_TEST_ASSERT(initial_state.resume_etag->size
+                     == package_etag.etag.size);
+    HOST_TEST_ASSERT(!memcmp(initial_state.resume_etag->value,
+                             package_etag.etag.value,
+                             package_etag.etag.size));
+    HOST_TEST_ASSERT(initial_state.resume_offset % FLASH_SECTOR_SIZE == 0);
+    HOST_TEST_ASSERT(initial_state.resume_offset >= boot.resume_min);
+    HOST_TEST_ASSERT(initial_state.resume_offset <= boot.resume_max);
+    return initial_state.resume_offset;
+}
+
+static void end_boot(void) {
+    exit(resumed ? EXIT_RESUMED : EXIT_SUCCESS);
+}
+
+static void check_download_slot(void) {
+    const uint8_t *slot =
+            host_flash_memory() + PFB_HOST_DOWNLOAD_SLOT_OFFSET;
+    HOST_TEST_ASSERT(!memcmp(slot, image, image_size));
+    uint8_t digest[DIGEST_SIZE];
+    HOST_TEST_ASSERT(!mbedtls_sha256_ret(slot, image_size - DIGEST_SIZE,
+                                         digest, 0));
+    HOST_TEST_ASSERT(!memcmp(digest, slot + image_size - DIGEST_SIZE,
+                             DIGEST_SIZE));
+}
+
+static uint32_t sector_offset(size_t sector) {
+    return PFB_HOST_DOWNLOAD_SLOT_OFFSET
+           + (uint32_t) sector * FLASH_SECTOR_SIZE;
+}
+
+/* The sectors from the start offset of the download on are erased at most
+ * once during the boot, and only once data up to them has been received; if
+ * the download is complete, all of them have been */
+static void check_erases(size_t start, size_t offset, bool complete) {
+    for (size_t sector = 0; sector < IMAGE_SECTORS; sector++) {
+        const size_t start_bytes = sector * FLASH_SECTOR_SIZE;
+        const uint32_t erases =
+                host_flash_get_erase_count(sector_offset(sector))
+                - boot_erase_counts[sector];
+        if (start_bytes < start || start_bytes >= offset) {
+            HOST_TEST_ASSERT(!erases);
+        } else if (complete) {
+            HOST_TEST_ASSERT(erases == 1);
+        } else {
+            HOST_TEST_ASSERT(erases <= 1);
+        }
+    }
+}
+
+static void write_stale_image(void) {
+    static const uint8_t zeros[FLASH_SECTOR_SIZE];
+    for (size_t sector = 0; sector < IMAGE_SECTORS; sector++) {
+        flash_range_program(sector_offset(sector), zeros, sizeof(zeros));
+    }
+}
+
+static void boot_task(void *unused) {
+    (void) unused;
+    // the simulated flash is only loaded in the forked boots, so that they
+    // see each other's changes
+    if (boot.fresh) {
+        write_stale_image();
+    }
+    for (size_t sector = 0; sector < IMAGE_SECTORS; sector++) {
+        boot_erase_counts[sector] =
+                host_flash_get_erase_count(sector_offset(sector));
+    }
+    HOST_TEST_ASSERT(!fw_update_install(NULL));
+    if (boot.check_only) {
+        HOST_TEST_ASSERT(initial_state.result
+                         != ANJAY_FW_UPDATE_INITIAL_DOWNLOADING);
+        end_boot();
+    }
+
+    const size_t start = start_download();
+    // nothing is erased up front
+    check_erases(start, start, false);
+    size_t offset = start;
+    if (boot.program_error) {
+        host_flash_inject_program_error(PFB_HOST_DOWNLOAD_SLOT_OFFSET
+                                        + boot.program_error_offset);
+    }
+    uint32_t seed = boot.seed;
+    // CoAP blocks in odd rounds, random chunks in even ones
+    const bool blocks = seed % 2;
+    bool write_failed = false;
+    while (offset < boot.cut_offset) {
+        size_t len = blocks ? 1024 : 1 + host_test_rand(&seed) % 3000;
+        if (len > boot.cut_offset - offset) {
+            len = boot.cut_offset - offset;
+        }
+        if (handlers->stream_write(handlers_arg, &image[offset], len)) {
+            // the failing page is programmed before the end of this chunk
+            HOST_TEST_ASSERT(boot.program_error);
+            HOST_TEST_ASSERT(boot.program_error_offset < offset + len);
+            write_failed = true;
+            break;
+        }
+        offset += len;
+        check_erases(start, offset, false);
+    }
+
+    if (!write_failed && offset == image_size) {
+        const int result = handlers->stream_finish(handlers_arg);
+        HOST_TEST_ASSERT(result == boot.finish_result);
+        if (!result) {
+            check_download_slot();
+            check_erases(start, image_size, true);
+            end_boot();
+        }
+        // Anjay resets the download after a failed finish
+    }
+    host_cyw43_set_link_up(boot.link_up_on_reset);
+    handlers->reset(handlers_arg);
+    // the device restarts
+    end_boot();
+}
+
+/* Returns true if the boot has resumed the download */
+static bool run_boot(void) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    HOST_TEST_ASSERT(pid >= 0);
+    if (!pid) {
+        static StackType_t boot_task_stack[BOOT_TASK_SIZE];
+        static StaticTask_t boot_task_buffer;
+        xTaskCreateStatic(boot_task, "BootTask", BOOT_TASK_SIZE, NULL,
+                          tskIDLE_PRIORITY + 1, boot_task_stack,
+                          &boot_task_buffer);
+        vTaskStartScheduler();
+        exit(1);
+    }
+    int status;
+    HOST_TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+    HOST_TEST_ASSERT(WIFEXITED(status)
+                     && (WEXITSTATUS(status) == EXIT_SUCCESS
+                         || WEXITSTATUS(status) == EXIT_RESUMED));
+    return WEXITSTATUS(status) == EXIT_RESUMED;
+}
+
+/* pfb_write_to_flash_aligned_256_bytes() only accepts whole pages, so the
+ * image with its digest is a multiple of PFB_ALIGN_SIZE */
+static void make_image(uint32_t *seed) {
+    image_size = PFB_ALIGN_SIZE
+                 * (1 + host_test_rand(seed) % (IMAGE_MAX_SIZE
+                                                / PFB_ALIGN_SIZE));
+    for (size_t i = 0; i < image_size - DIGEST_SIZE; i++) {
+        image[i] = (uint8_t) host_test_rand(seed);
+    }
+    HOST_TEST_ASSERT(!mbedtls_sha256_ret(image, image_size - DIGEST_SIZE,
+                                         &image[image_size - DIGEST_SIZE],
+                                         0));
+}
+
+/* Returns the number of boots that have resumed the download */
+static size_t run_round(outcome_t outcome, uint32_t *seed) {
+    make_image(seed);
+    const uint32_t etag = host_test_rand(seed);
+    package_etag.etag.size = sizeof(etag);
+    memcpy(package_etag.etag.value, &etag, sizeof(etag));
+
+    // connection losses and transport errors at increasing offsets within
+    // the image
+    const size_t cuts = 1 + host_test_rand(seed) % MAX_CUTS;
+    size_t last_cut = 0;
+    size_t resumes = 0;
+    memset(&boot, 0, sizeof(boot));
+    for (size_t i = 0; i < cuts && last_cut < image_size - 1; i++) {
+        boot.fresh = !i;
+        boot.resume_max = last_cut;
+        boot.cut_offset =
+                last_cut + 1
+                + host_test_rand(seed) % (image_size - last_cut - 1);
+        boot.seed = host_test_rand(seed);
+        boot.link_up_on_reset = host_test_rand(seed) % 2;
+        resumes += run_boot();
+        last_cut = boot.cut_offset;
+    }
+
+    boot.fresh = false;
+    boot.resume_max = last_cut;
+    boot.seed = host_test_rand(seed);
+    boot.link_up_on_reset = false;
+    switch (outcome) {
+    case OUTCOME_COMPLETE:
+        boot.cut_offset = image_size;
+        break;
+    case OUTCOME_TRANSPORT_ERROR:
+        // in CoAP blocks, each sector boundary passed is checkpointed
+        boot.seed |= 1;
+        boot.cut_offset =
+                last_cut < image_size - 1
+                        ? last_cut + 1
+                                  + host_test_rand(seed)
+                                            % (image_size - last_cut - 1)
+                        : last_cut;
+        boot.link_up_on_reset = true;
+        break;
+    case OUTCOME_CORRUPTED:
+        image[image_size - 1] ^= 0x01;
+        boot.cut_offset = image_size;
+        boot.finish_result = ANJAY_FW_UPDATE_ERR_INTEGRITY_FAILURE;
+        break;
+    case OUTCOME_UNSUPPORTED:
+        image_size += PFB_ALIGN_SIZE / 2;
+        boot.cut_offset = image_size;
+        boot.finish_result = ANJAY_FW_UPDATE_ERR_UNSUPPORTED_PACKAGE_TYPE;
+        break;
+    case OUTCOME_PROGRAM_ERROR:
+        // a byte that is not left erased by programming, which could not be
+        // told from a failure
+        boot.program_error = true;
+        boot.program_error_offset =
+                last_cut + host_test_rand(seed) % (image_size - last_cut);
+        while (image[boot.program_error_offset] == 0xFF) {
+            boot.program_error_offset =
+                    last_cut + (boot.program_error_offset + 1 - last_cut)
+                                       % (image_size - last_cut);
+        }
+        boot.cut_offset = image_size;
+        // if the failing page is only programmed when the download is
+        // finished
+        boot.finish_result = -1;
+        break;
+    }
+    resumes += run_boot();
+
+    if (outcome == OUTCOME_TRANSPORT_ERROR) {
+        boot.resume_min =
+                boot.cut_offset / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+        boot.resume_max = boot.cut_offset;
+        boot.cut_offset = image_size;
+        boot.link_up_on_reset = false;
+        boot.seed = host_test_rand(seed);
+        resumes += run_boot();
+        boot.resume_min = 0;
+    }
+
+    if (outcome == OUTCOME_PROGRAM_ERROR) {
+        // the data programmed before the error has been verified, so the
+        // download is resumed from the last checkpoint
+        boot.program_error = false;
+        boot.finish_result = 0;
+        boot.resume_max = boot.program_error_offset;
+        boot.seed = host_test_rand(seed);
+        resumes += run_boot();
+    }
+
+    // whatever the outcome, there is nothing to resume afterwards
+    boot.check_only = true;
+    run_boot();
+    return resumes;
+}
+
+int main(void) {
+    char flash_file[] = "/tmp/fw_update_resume_XXXXXX";
+    const int fd = mkstemp(flash_file);
+    HOST_TEST_ASSERT(fd >= 0);
+    close(fd);
+    // read by the simulated flash when the first boot accesses it
+    setenv("ANJAY_PICO_HOST_FLASH_FILE", flash_file, 1);
+
+    uint32_t seed = 0x0f1e2d3c;
+    size_t resumes = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        resumes += run_round((outcome_t) (round % 5), &seed);
+    }
+    unlink(flash_file);
+    HOST_TEST_ASSERT(resumes >= ROUNDS);
+    return 0;
+}
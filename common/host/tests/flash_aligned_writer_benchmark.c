@@ -0,0 +1,111 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Time flash_aligned_writer spends passing a 1 MiB image to its callback, in
+ * the two ways firmware_update.c could set it up:
+ *
+ * - staged: align_bytes is 0, so every byte is copied into the batch buffer
+ *   and written out once the buffer is full;
+ * - zero-copy: align_bytes is PFB_ALIGN_SIZE, so aligned spans of the input
+ *   go to the callback as they are and only the unaligned rest is staged.
+ *
+ * The image is written in CoAP blocks of random sizes (powers of two from 16
+ * to 1024 bytes, so those of 256 bytes and more are aligned) and in random
+ * chunks of 16 to 3000 bytes. The callback copies the data to a RAM image of
+ * the slot in both cases, so what differs is the staging copy and the number
+ * of callback calls. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include <pico_fota_bootloader.h>
+
+#include "flash_aligned_writer.h"
+#include "host_test.h"
+
+#define ITERATIONS 10
+#define IMAGE_SIZE (1024 * 1024)
+#define BATCH_BUF_SIZE (16 * PFB_ALIGN_SIZE)
+#define MIN_CHUNK_SIZE 16
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t slot[IMAGE_SIZE];
+static uint8_t batch_buf[BATCH_BUF_SIZE];
+static size_t chunk_sizes[IMAGE_SIZE / MIN_CHUNK_SIZE];
+static size_t chunk_count;
+
+static int copy_to_slot(uint8_t *src, size_t offset_bytes, size_t len_bytes) {
+    HOST_TEST_ASSERT(offset_bytes + len_bytes <= IMAGE_SIZE);
+    memcpy(&slot[offset_bytes], src, len_bytes);
+    return 0;
+}
+
+static void make_chunks(uint32_t *seed, bool blocks) {
+    chunk_count = 0;
+    for (size_t offset = 0; offset < IMAGE_SIZE;) {
+        size_t len =
+                blocks ? (size_t) MIN_CHUNK_SIZE << host_test_rand(seed) % 7
+                       : MIN_CHUNK_SIZE
+                                 + host_test_rand(seed)
+                                           % (3000 - MIN_CHUNK_SIZE + 1);
+        if (len > IMAGE_SIZE - offset) {
+            len = IMAGE_SIZE - offset;
+        }
+        chunk_sizes[chunk_count++] = len;
+        offset += len;
+    }
+}
+
+static void run(const char *name, size_t align_bytes) {
+    uint64_t elapsed_us = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        memset(slot, 0, sizeof(slot));
+        flash_aligned_writer_t writer;
+        flash_aligned_writer_new(batch_buf, sizeof(batch_buf), align_bytes,
+                                 copy_to_slot, &writer);
+        const uint64_t start_us = time_us_64();
+        size_t offset = 0;
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            HOST_TEST_ASSERT(!flash_aligned_writer_write(
+                    &writer, &image[offset], chunk_sizes[chunk]));
+            offset += chunk_sizes[chunk];
+        }
+        HOST_TEST_ASSERT(!flash_aligned_writer_flush(&writer));
+        elapsed_us += time_us_64() - start_us;
+        HOST_TEST_ASSERT(!memcmp(slot, image, IMAGE_SIZE));
+    }
+    host_benchmark_report(name, elapsed_us,
+                          ITERATIONS * (uint64_t) chunk_count, "chunk");
+}
+
+int main(void) {
+    uint32_t seed = 0x0a11c0de;
+    for (size_t i = 0; i < IMAGE_SIZE; i++) {
+        image[i] = (uint8_t) host_test_rand(&seed);
+    }
+
+    make_chunks(&seed, true);
+    run("staged, CoAP blocks", 0);
+    run("zero-copy, CoAP blocks", PFB_ALIGN_SIZE);
+
+    make_chunks(&seed, false);
+    run("staged, random chunks", 0);
+    run("zero-copy, random chunks", PFB_ALIGN_SIZE);
+    return 0;
+}
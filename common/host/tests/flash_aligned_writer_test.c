@@ -0,0 +1,103 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* flash_aligned_writer fed with chunks of random sizes: the spans passed to
+ * the callback must be contiguous, aligned and hold the written data, and
+ * aligned spans must be passed without copying. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "flash_aligned_writer.h"
+#include "host_test.h"
+
+#define ALIGN_BYTES 256
+#define BATCH_BYTES (16 * ALIGN_BYTES)
+#define IMAGE_BYTES (256 * 1024)
+#define ROUNDS 100
+
+static uint8_t image[IMAGE_BYTES];
+static uint8_t written[IMAGE_BYTES];
+static uint8_t batch_buf[BATCH_BYTES];
+
+static struct {
+    size_t next_offset;
+    bool ended_unaligned;
+    size_t direct_bytes;
+} state;
+
+static int writer_cb(uint8_t *src, size_t offset_bytes, size_t len_bytes) {
+    // only the last span may end at an unaligned offset
+    HOST_TEST_ASSERT(!state.ended_unaligned);
+    HOST_TEST_ASSERT(offset_bytes == state.next_offset);
+    HOST_TEST_ASSERT(offset_bytes % ALIGN_BYTES == 0);
+    HOST_TEST_ASSERT(len_bytes > 0);
+    HOST_TEST_ASSERT(offset_bytes + len_bytes <= IMAGE_BYTES);
+    HOST_TEST_ASSERT(!memcmp(src, &image[offset_bytes], len_bytes));
+
+    memcpy(&written[offset_bytes], src, len_bytes);
+    state.next_offset += len_bytes;
+    state.ended_unaligned = len_bytes % ALIGN_BYTES != 0;
+    if (src != batch_buf) {
+        // a direct span points into the data passed to the writer
+        HOST_TEST_ASSERT(src == &image[offset_bytes]);
+        state.direct_bytes += len_bytes;
+    } else {
+        HOST_TEST_ASSERT(len_bytes <= BATCH_BYTES);
+    }
+    return 0;
+}
+
+int main(void) {
+    uint32_t seed = 0xf1a5b00c;
+    for (size_t i = 0; i < IMAGE_BYTES; i++) {
+        image[i] = (uint8_t) host_test_rand(&seed);
+    }
+
+    size_t direct_bytes = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        memset(&state, 0, sizeof(state));
+        memset(written, 0, sizeof(written));
+        flash_aligned_writer_t writer;
+        flash_aligned_writer_new(batch_buf, BATCH_BYTES, ALIGN_BYTES,
+                                 writer_cb, &writer);
+
+        const size_t total = 1 + host_test_rand(&seed) % IMAGE_BYTES;
+        // odd rounds mimic CoAP blocks, even ones are fully random
+        const size_t block = 16 << (host_test_rand(&seed) % 7);
+        for (size_t offset = 0; offset < total;) {
+            size_t len = block;
+            if (round % 2 == 0) {
+                len = 1 + host_test_rand(&seed) % (3 * BATCH_BYTES);
+            }
+            if (len > total - offset) {
+                len = total - offset;
+            }
+            HOST_TEST_ASSERT(!flash_aligned_writer_write(&writer,
+                                                         &image[offset], len));
+            offset += len;
+        }
+        HOST_TEST_ASSERT(!flash_aligned_writer_flush(&writer));
+
+        HOST_TEST_ASSERT(state.next_offset == total);
+        HOST_TEST_ASSERT(!memcmp(written, image, total));
+        direct_bytes += state.direct_bytes;
+    }
+    // aligned chunks are passed without copying
+    HOST_TEST_ASSERT(direct_bytes > 0);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * Helpers shared by the host tests and benchmarks. A failed check prints its
+ * location and ends the test with a nonzero exit status, which is what CTest
+ * looks at.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOST_TEST_ASSERT(Cond)                                        \
+    do {                                                              \
+        if (!(Cond)) {                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,    \
+                    __LINE__, #Cond);                                 \
+            exit(1);                                                  \
+        }                                                             \
+    } while (0)
+
+/* xorshift32; tests seed it with a constant so that failures reproduce */
+static inline uint32_t host_test_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static inline void host_benchmark_report(const char *name,
+                                         uint64_t elapsed_us,
+                                         uint64_t items,
+                                         const char *item_unit) {
+    printf("%-40s %10" PRIu64 " us %12.2f ns/%s\n", name, elapsed_us,
+           items ? (double) elapsed_us * 1000.0 / (double) items : 0.0,
+           item_unit);
+}
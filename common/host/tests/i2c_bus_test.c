@@ -0,0 +1,271 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* i2c_bus queue semantics on the host backend: synchronous transfers,
+ * cancellation of queued transactions, and a timeout racing with the
+ * completion on another thread, the way i2c_bus_transfer() uses the bus. */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hardware/i2c.h"
+
+#include "host_test.h"
+#include "i2c_bus.h"
+#include "i2c_bus_host.h"
+
+#define DEVICE_ADDR 0x60
+#define MISSING_ADDR 0x61
+#define RACE_ITERATIONS 2000
+
+/* Register file with an auto-incremented pointer, set by the first byte
+ * written, and optional clock stretching */
+typedef struct {
+    uint8_t regs[16];
+    uint8_t pointer;
+    atomic_uint stretch_us;
+} sim_device_t;
+
+static int sim_write(void *arg, const uint8_t *src, size_t len, bool nostop) {
+    (void) nostop;
+    sim_device_t *device = (sim_device_t *) arg;
+    const unsigned stretch_us = atomic_load(&device->stretch_us);
+    if (stretch_us) {
+        usleep(stretch_us);
+    }
+    device->pointer = src[0] % sizeof(device->regs);
+    for (size_t i = 1; i < len; i++) {
+        device->regs[device->pointer] = src[i];
+        device->pointer = (device->pointer + 1) % sizeof(device->regs);
+    }
+    return (int) len;
+}
+
+static int sim_read(void *arg, uint8_t *dst, size_t len, bool nostop) {
+    (void) nostop;
+    sim_device_t *device = (sim_device_t *) arg;
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = device->regs[device->pointer];
+        device->pointer = (device->pointer + 1) % sizeof(device->regs);
+    }
+    return (int) len;
+}
+
+static const host_i2c_device_t SIM_DEVICE = {
+    .write = sim_write,
+    .read = sim_read
+};
+
+static sim_device_t device;
+
+static void count_done(i2c_bus_transaction_t *transaction) {
+    ++*(int *) transaction->arg;
+}
+
+static void test_synchronous(void) {
+    const uint8_t write[] = { 2, 0xAB, 0xCD };
+    const uint8_t reg = 2;
+    uint8_t read[2] = { 0 };
+    int done_count = 0;
+
+    i2c_bus_transaction_t transaction = {
+        .addr = DEVICE_ADDR,
+        .tx = write,
+        .tx_len = sizeof(write),
+        .done = count_done,
+        .arg = &done_count
+    };
+    HOST_TEST_ASSERT(!i2c_bus_submit(&transaction));
+    HOST_TEST_ASSERT(done_count == 1);
+    HOST_TEST_ASSERT(transaction.result == 0);
+
+    transaction = (i2c_bus_transaction_t) {
+        .addr = DEVICE_ADDR,
+        .tx = &reg,
+        .tx_len = 1,
+        .rx = read,
+        .rx_len = sizeof(read),
+        .done = count_done,
+        .arg = &done_count
+    };
+    HOST_TEST_ASSERT(!i2c_bus_submit(&transaction));
+    HOST_TEST_ASSERT(done_count == 2);
+    HOST_TEST_ASSERT(transaction.result == 0);
+    HOST_TEST_ASSERT(read[0] == 0xAB && read[1] == 0xCD);
+
+    // a missing device fails like a NACK
+    transaction.addr = MISSING_ADDR;
+    HOST_TEST_ASSERT(!i2c_bus_submit(&transaction));
+    HOST_TEST_ASSERT(done_count == 3);
+    HOST_TEST_ASSERT(transaction.result < 0);
+
+    // invalid transactions are rejected without calling done
+    transaction.tx_len = 0;
+    transaction.rx_len = 0;
+    HOST_TEST_ASSERT(i2c_bus_submit(&transaction) < 0);
+    HOST_TEST_ASSERT(done_count == 3);
+}
+
+static void test_cancel_queued(void) {
+    const uint8_t reg = 0;
+    int done_count[3] = { 0 };
+    i2c_bus_transaction_t transactions[3];
+    for (int i = 0; i < 3; i++) {
+        transactions[i] = (i2c_bus_transaction_t) {
+            .addr = DEVICE_ADDR,
+            .tx = &reg,
+            .tx_len = 1,
+            .done = count_done,
+            .arg = &done_count[i]
+        };
+    }
+
+    i2c_bus_host_set_deferred(true);
+    for (int i = 0; i < 3; i++) {
+        HOST_TEST_ASSERT(!i2c_bus_submit(&transactions[i]));
+    }
+    // from the middle and then from the tail of the queue
+    i2c_bus_cancel(&transactions[1]);
+    HOST_TEST_ASSERT(i2c_bus_host_complete_next());
+    i2c_bus_cancel(&transactions[2]);
+    HOST_TEST_ASSERT(!i2c_bus_host_complete_next());
+    HOST_TEST_ASSERT(done_count[0] == 1);
+    HOST_TEST_ASSERT(done_count[1] == 0);
+    HOST_TEST_ASSERT(done_count[2] == 0);
+
+    // the queue still works after the tail has been removed
+    HOST_TEST_ASSERT(!i2c_bus_submit(&transactions[1]));
+    HOST_TEST_ASSERT(i2c_bus_host_complete_next());
+    HOST_TEST_ASSERT(done_count[1] == 1);
+    i2c_bus_host_set_deferred(false);
+}
+
+/* State of one i2c_bus_transfer()-like call; alive is cleared when the call
+ * would have returned and its stack frame would be gone */
+typedef struct {
+    i2c_bus_transaction_t transaction;
+    sem_t done;
+    atomic_bool alive;
+    atomic_bool in_done;
+} transfer_t;
+
+static atomic_bool stop_completer;
+static atomic_int late_completions;
+static uint32_t done_seed = 0xD0AE;
+
+static void transfer_done(i2c_bus_transaction_t *transaction) {
+    transfer_t *transfer = (transfer_t *) transaction->arg;
+    atomic_store(&transfer->in_done, true);
+    if (!atomic_load(&transfer->alive)) {
+        atomic_fetch_add(&late_completions, 1);
+    }
+    // widen the window in which the timeout may hit
+    usleep(host_test_rand(&done_seed) % 50);
+    atomic_store(&transfer->in_done, false);
+    sem_post(&transfer->done);
+}
+
+/* Stands for the I2C interrupt, running on the other core */
+static void *completer(void *arg) {
+    (void) arg;
+    while (!atomic_load(&stop_completer)) {
+        if (!i2c_bus_host_complete_next()) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_timeout_race(void) {
+    static transfer_t transfers[RACE_ITERATIONS];
+    const uint8_t reg = 0;
+    uint32_t seed = 0x12C;
+    int timeouts = 0;
+    int completions = 0;
+
+    i2c_bus_host_set_deferred(true);
+    pthread_t thread;
+    HOST_TEST_ASSERT(!pthread_create(&thread, NULL, completer, NULL));
+
+    for (int i = 0; i < RACE_ITERATIONS; i++) {
+        transfer_t *transfer = &transfers[i];
+        transfer->transaction = (i2c_bus_transaction_t) {
+            .addr = DEVICE_ADDR,
+            .tx = &reg,
+            .tx_len = 1,
+            .done = transfer_done,
+            .arg = transfer
+        };
+        HOST_TEST_ASSERT(!sem_init(&transfer->done, 0, 0));
+        atomic_store(&transfer->alive, true);
+        atomic_store(&device.stretch_us, host_test_rand(&seed) % 200);
+
+        HOST_TEST_ASSERT(!i2c_bus_submit(&transfer->transaction));
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long) (host_test_rand(&seed) % 300) * 1000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        int result;
+        while ((result = sem_timedwait(&transfer->done, &deadline))
+                       && errno == EINTR) {
+        }
+        if (result) {
+            // timeout, as in i2c_bus_transfer(): after the cancel, done must
+            // have either returned or never be called
+            i2c_bus_cancel(&transfer->transaction);
+            HOST_TEST_ASSERT(!atomic_load(&transfer->in_done));
+            timeouts++;
+        } else {
+            completions++;
+        }
+        atomic_store(&transfer->alive, false);
+    }
+
+    atomic_store(&stop_completer, true);
+    pthread_join(thread, NULL);
+    i2c_bus_host_set_deferred(false);
+    atomic_store(&device.stretch_us, 0);
+
+    HOST_TEST_ASSERT(atomic_load(&late_completions) == 0);
+    // both paths have been exercised
+    HOST_TEST_ASSERT(timeouts > 0);
+    HOST_TEST_ASSERT(completions > 0);
+    printf("timeout race: %d timeouts, %d completions\n", timeouts,
+           completions);
+}
+
+int main(void) {
+    HOST_TEST_ASSERT(!host_i2c_attach(i2c0, DEVICE_ADDR, &SIM_DEVICE, &device));
+    HOST_TEST_ASSERT(!i2c_bus_init(i2c0, 400000));
+
+    test_synchronous();
+    test_cancel_queued();
+    test_timeout_race();
+
+    i2c_bus_release();
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Throughput of onewire_crc8(), built with the ONEWIRE_CRC8_IMPL the target
+ * selects, over ROM code and scratchpad sized buffers */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "host_test.h"
+#include "onewire.h"
+
+#define ITERATIONS 2000000
+
+static const char *const IMPL_NAMES[] = {
+    [ONEWIRE_CRC8_BITWISE] = "bitwise",
+    [ONEWIRE_CRC8_NIBBLE] = "nibble",
+    [ONEWIRE_CRC8_TABLE] = "table"
+};
+
+static void run(const char *name, const uint8_t *data, size_t len) {
+    // accumulated so that the calls cannot be optimized out
+    volatile uint8_t sink = 0;
+    const uint64_t start_us = time_us_64();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink ^= onewire_crc8(data, len);
+    }
+    const uint64_t elapsed_us = time_us_64() - start_us;
+
+    char label[64];
+    snprintf(label, sizeof(label), "crc8 %s, %s (%zu bytes)",
+             IMPL_NAMES[ONEWIRE_CRC8_IMPL], name, len);
+    host_benchmark_report(label, elapsed_us, (uint64_t) ITERATIONS * len,
+                          "byte");
+    (void) sink;
+}
+
+int main(void) {
+    uint32_t seed = 0xC0FFEE;
+    uint8_t buf[9];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t) host_test_rand(&seed);
+    }
+    // a ROM code and a DS18B20 scratchpad, without their CRC byte
+    run("rom code", buf, 7);
+    run("scratchpad", buf, 8);
+    return 0;
+}
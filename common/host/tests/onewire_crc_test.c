@@ -0,0 +1,69 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks onewire_crc8(), built with the ONEWIRE_CRC8_IMPL the test target
+ * selects, against the bitwise definition of the Dallas/Maxim CRC-8 */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "host_test.h"
+#include "onewire.h"
+
+#define MAX_BUFFER_SIZE 64
+#define RANDOM_BUFFERS 10000
+
+static uint8_t reference_crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            const uint8_t mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+int main(void) {
+    // ROM code from Maxim application note 27
+    static const uint8_t rom_code[] = { 0x02, 0x1C, 0xB8, 0x01,
+                                        0x00, 0x00, 0x00, 0xA2 };
+    HOST_TEST_ASSERT(onewire_crc8(rom_code, sizeof(rom_code) - 1) == 0xA2);
+    // a buffer followed by its CRC has a CRC of 0
+    HOST_TEST_ASSERT(onewire_crc8(rom_code, sizeof(rom_code)) == 0);
+    HOST_TEST_ASSERT(onewire_crc8(NULL, 0) == 0);
+
+    for (unsigned value = 0; value < 256; value++) {
+        const uint8_t byte = (uint8_t) value;
+        HOST_TEST_ASSERT(onewire_crc8(&byte, 1) == reference_crc8(&byte, 1));
+    }
+
+    uint32_t seed = 0x1D5B18B2;
+    uint8_t buf[MAX_BUFFER_SIZE];
+    for (int i = 0; i < RANDOM_BUFFERS; i++) {
+        const size_t len = host_test_rand(&seed) % (MAX_BUFFER_SIZE + 1);
+        for (size_t j = 0; j < len; j++) {
+            buf[j] = (uint8_t) host_test_rand(&seed);
+        }
+        HOST_TEST_ASSERT(onewire_crc8(buf, len) == reference_crc8(buf, len));
+    }
+    return 0;
+}
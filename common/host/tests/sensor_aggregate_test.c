@@ -0,0 +1,177 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Sliding and tumbling windows of sensor_aggregate fed with random streams,
+ * checked after every sample against the statistics recomputed from scratch
+ * over the samples the window should hold */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "host_test.h"
+#include "sensor_aggregate.h"
+
+#define STREAM_LENGTH 2000
+#define STREAMS_PER_KIND 8
+
+typedef enum {
+    STREAM_NOISE,
+    STREAM_WIDE,
+    STREAM_CONSTANT,
+    STREAM_RAMP,
+    STREAM_SPIKES,
+    STREAM_KIND_COUNT
+} stream_kind_t;
+
+static int32_t stream[STREAM_LENGTH];
+
+static void make_stream(uint32_t *seed, stream_kind_t kind) {
+    const int32_t base = (int32_t) (host_test_rand(seed) % 100001) - 50000;
+    for (int32_t i = 0; i < STREAM_LENGTH; i++) {
+        const int32_t r = (int32_t) (host_test_rand(seed) >> 1);
+        switch (kind) {
+        case STREAM_NOISE:
+            stream[i] = base + r % 201 - 100;
+            break;
+        case STREAM_WIDE:
+            stream[i] = r % 200001 - 100000;
+            break;
+        case STREAM_CONSTANT:
+            stream[i] = base;
+            break;
+        case STREAM_RAMP:
+            stream[i] = base + (i % 300 < 150 ? i % 300 : 300 - i % 300) * 50;
+            break;
+        default:
+            stream[i] = base + (r % 16 ? r % 21 - 10 : r % 80001 - 40000);
+            break;
+        }
+    }
+}
+
+static sensor_aggregate_result_t naive_stats(const int32_t *values,
+                                             uint32_t count) {
+    sensor_aggregate_result_t result = { 0 };
+    if (!count) {
+        return result;
+    }
+    long double sum = 0;
+    result.count = count;
+    result.min = values[0];
+    result.max = values[0];
+    for (uint32_t i = 0; i < count; i++) {
+        sum += values[i];
+        if (values[i] < result.min) {
+            result.min = values[i];
+        }
+        if (values[i] > result.max) {
+            result.max = values[i];
+        }
+    }
+    const long double mean = sum / count;
+    long double sum_sq = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum_sq += (values[i] - mean) * (values[i] - mean);
+    }
+    result.mean = (double) mean;
+    result.variance = (double) (sum_sq / count);
+    return result;
+}
+
+static void check_result(const sensor_aggregate_result_t *actual,
+                         const sensor_aggregate_result_t *expected) {
+    HOST_TEST_ASSERT(actual->count == expected->count);
+    if (!expected->count) {
+        return;
+    }
+    HOST_TEST_ASSERT(actual->min == expected->min);
+    HOST_TEST_ASSERT(actual->max == expected->max);
+    // the sums are exact, so only the final floating point steps can differ
+    const double range = (double) expected->max - expected->min;
+    HOST_TEST_ASSERT(fabs(actual->mean - expected->mean)
+                     <= 1e-9 * (1.0 + fabs(expected->mean)));
+    HOST_TEST_ASSERT(fabs(actual->variance - expected->variance)
+                     <= 1e-9 * (1.0 + range * range));
+}
+
+static void check_sliding(uint32_t size) {
+    sensor_sliding_window_t window;
+    sensor_sliding_window_reset(&window, size);
+    HOST_TEST_ASSERT(sensor_sliding_window_get(&window).count == 0);
+    for (uint32_t i = 0; i < STREAM_LENGTH; i++) {
+        sensor_sliding_window_add(&window, stream[i]);
+        const uint32_t count = i + 1 < size ? i + 1 : size;
+        const sensor_aggregate_result_t expected =
+                naive_stats(&stream[i + 1 - count], count);
+        const sensor_aggregate_result_t actual =
+                sensor_sliding_window_get(&window);
+        check_result(&actual, &expected);
+    }
+}
+
+static void check_tumbling(uint32_t *seed, uint64_t length_us) {
+    sensor_tumbling_window_t window;
+    sensor_tumbling_window_reset(&window, length_us);
+
+    sensor_aggregate_result_t expected = { 0 };
+    uint64_t now_us = host_test_rand(seed);
+    uint64_t start_us = now_us;
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < STREAM_LENGTH; i++) {
+        // mostly regular sampling, with the occasional gap spanning several
+        // intervals
+        now_us += host_test_rand(seed) % 64
+                          ? host_test_rand(seed) % (length_us / 4 + 1)
+                          : host_test_rand(seed) % (4 * length_us);
+        const bool completed = i > first && now_us - start_us >= length_us;
+        if (completed) {
+            expected = naive_stats(&stream[first], i - first);
+            first = i;
+        }
+        if (i == first) {
+            start_us = now_us;
+        }
+        HOST_TEST_ASSERT(sensor_tumbling_window_add(&window, now_us, stream[i])
+                         == completed);
+        const sensor_aggregate_result_t actual =
+                sensor_tumbling_window_get(&window);
+        check_result(&actual, &expected);
+    }
+}
+
+int main(void) {
+    uint32_t seed = 0x5a6c0913;
+
+    sensor_sliding_window_t window;
+    sensor_sliding_window_reset(&window, 0);
+    HOST_TEST_ASSERT(window.size == 1);
+    sensor_sliding_window_reset(&window, SENSOR_AGGREGATE_MAX_WINDOW + 1);
+    HOST_TEST_ASSERT(window.size == SENSOR_AGGREGATE_MAX_WINDOW);
+
+    for (int kind = 0; kind < STREAM_KIND_COUNT; kind++) {
+        for (int i = 0; i < STREAMS_PER_KIND; i++) {
+            make_stream(&seed, (stream_kind_t) kind);
+            check_sliding(1);
+            check_sliding(SENSOR_AGGREGATE_MAX_WINDOW);
+            check_sliding(1 + host_test_rand(&seed)
+                                      % SENSOR_AGGREGATE_MAX_WINDOW);
+            check_tumbling(&seed, 1000);
+            check_tumbling(&seed, 1 + host_test_rand(&seed) % 10000000);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The average and median filters applied to LM35 traces replayed through the
+ * host ADC backend, in every window size the LM35 object can fetch, checked
+ * against a sort-based reference, plus the rounding of the fixed-point
+ * result on hand-computed blocks */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hardware/adc.h"
+
+#include "host_test.h"
+#include "lm35_adc.h"
+#include "sensor_filter.h"
+
+#define LM35_CHANNEL 0
+#define TRACE_LENGTH 4096
+#define SPIKE_PERIOD 16
+
+/* 3.3 V reference, 12 bits, 10 mV per degree */
+#define COUNTS_AT_MILLICELSIUS(Mc) ((Mc) * 4096 / 330000)
+
+typedef enum {
+    TRACE_STEADY,
+    TRACE_RAMP,
+    TRACE_SPIKES,
+    TRACE_COUNT
+} trace_kind_t;
+
+typedef struct {
+    uint16_t samples[TRACE_LENGTH];
+    bool spike[TRACE_LENGTH];
+    size_t position;
+} trace_t;
+
+static trace_t trace;
+
+static uint16_t replay_trace(uint input, void *arg) {
+    trace_t *replayed = (trace_t *) arg;
+    HOST_TEST_ASSERT(input == LM35_CHANNEL);
+    return replayed->samples[replayed->position++ % TRACE_LENGTH];
+}
+
+static void make_trace(uint32_t *seed, trace_kind_t kind) {
+    memset(&trace, 0, sizeof(trace));
+    for (int32_t i = 0; i < TRACE_LENGTH; i++) {
+        // steady at 25 degrees or heating up from 20 to 80 degrees, with a
+        // few LSB of noise
+        const int32_t millicelsius =
+                kind == TRACE_RAMP ? 20000 + i * 60000 / TRACE_LENGTH : 25000;
+        const int32_t noise = (int32_t) (host_test_rand(seed) % 7) - 3;
+        trace.samples[i] =
+                (uint16_t) (COUNTS_AT_MILLICELSIUS(millicelsius) + noise);
+        // glitches hitting either end of the range
+        if (kind == TRACE_SPIKES && !(host_test_rand(seed) % SPIKE_PERIOD)) {
+            trace.samples[i] = host_test_rand(seed) % 2 ? 4095 : 0;
+            trace.spike[i] = true;
+        }
+    }
+}
+
+static void sort(uint16_t *samples, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        const uint16_t value = samples[i];
+        size_t j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = value;
+    }
+}
+
+/* Rounds a nonnegative numerator / denominator to nearest, halves up */
+static uint32_t round_div(uint64_t numerator, uint64_t denominator) {
+    return (uint32_t) ((2 * numerator + denominator) / (2 * denominator));
+}
+
+static uint32_t reference(sensor_filter_type_t type,
+                          const uint16_t *samples,
+                          size_t count) {
+    uint16_t sorted[LM35_ADC_MAX_FETCH];
+    memcpy(sorted, samples, count * sizeof(*samples));
+    sort(sorted, count);
+
+    uint64_t sum = 0;
+    size_t first = 0;
+    size_t last = count - 1;
+    if (type == SENSOR_FILTER_MEDIAN) {
+        first = (count - 1) / 2;
+        last = count / 2;
+    }
+    for (size_t i = first; i <= last; i++) {
+        sum += sorted[i];
+    }
+    return round_div(sum << SENSOR_FILTER_FRACTION_BITS, last - first + 1);
+}
+
+static void check_trace(sensor_filter_type_t type, size_t count) {
+    uint16_t samples[LM35_ADC_MAX_FETCH];
+    uint16_t sorted[LM35_ADC_MAX_FETCH];
+    trace.position = 0;
+    while (trace.position + count <= TRACE_LENGTH) {
+        const size_t start = trace.position;
+        HOST_TEST_ASSERT(lm35_adc_get_latest(LM35_CHANNEL, samples, count)
+                         == count);
+        HOST_TEST_ASSERT(!memcmp(samples, &trace.samples[start],
+                                 count * sizeof(*samples)));
+
+        const uint32_t expected = reference(type, samples, count);
+        memcpy(sorted, samples, count * sizeof(*samples));
+        sort(sorted, count);
+        const uint32_t result = sensor_filter_apply(type, samples, count);
+        HOST_TEST_ASSERT(result == expected);
+
+        // the samples are reordered at most
+        sort(samples, count);
+        HOST_TEST_ASSERT(!memcmp(samples, sorted, count * sizeof(*samples)));
+
+        // as long as fewer than half of the samples are glitches, the median
+        // is within the range of the valid ones
+        size_t spikes = 0;
+        uint32_t valid_min = UINT32_MAX;
+        uint32_t valid_max = 0;
+        for (size_t i = start; i < start + count; i++) {
+            if (trace.spike[i]) {
+                spikes++;
+                continue;
+            }
+            if (trace.samples[i] < valid_min) {
+                valid_min = trace.samples[i];
+            }
+            if (trace.samples[i] > valid_max) {
+                valid_max = trace.samples[i];
+            }
+        }
+        if (type == SENSOR_FILTER_MEDIAN && 2 * spikes < count) {
+            HOST_TEST_ASSERT(result
+                             >= valid_min << SENSOR_FILTER_FRACTION_BITS);
+            HOST_TEST_ASSERT(result
+                             <= valid_max << SENSOR_FILTER_FRACTION_BITS);
+        }
+        // overlapping windows, so that every spike position is covered
+        trace.position = start + count / 2 + 1;
+    }
+}
+
+static void check_block(sensor_filter_type_t type,
+                        const uint16_t *block,
+                        size_t count,
+                        uint32_t expected) {
+    uint16_t samples[8];
+    memcpy(samples, block, count * sizeof(*block));
+    HOST_TEST_ASSERT(sensor_filter_apply(type, samples, count) == expected);
+}
+
+static void test_rounding(void) {
+    // a single sample is only shifted
+    check_block(SENSOR_FILTER_AVERAGE, (const uint16_t[]) { 4095 }, 1,
+                4095 << SENSOR_FILTER_FRACTION_BITS);
+    check_block(SENSOR_FILTER_MEDIAN, (const uint16_t[]) { 0 }, 1, 0);
+    check_block(SENSOR_FILTER_MEDIAN, (const uint16_t[]) { 310 }, 1,
+                310 << SENSOR_FILTER_FRACTION_BITS);
+
+    // 16/3 = 5.33 rounds down, 32/3 = 10.67 rounds up, 3 * 16/6 = 8 is exact
+    check_block(SENSOR_FILTER_AVERAGE, (const uint16_t[]) { 0, 0, 1 }, 3, 5);
+    check_block(SENSOR_FILTER_AVERAGE, (const uint16_t[]) { 1, 0, 1 }, 3, 11);
+    check_block(SENSOR_FILTER_AVERAGE,
+                (const uint16_t[]) { 1, 0, 1, 0, 1, 0 }, 6, 8);
+    // 16/32 = 0.5 rounds up
+    uint16_t block[256] = { 1 };
+    HOST_TEST_ASSERT(sensor_filter_apply(SENSOR_FILTER_AVERAGE, block, 32)
+                     == 1);
+
+    // the middle pair of an even count is averaged, which is exact with the
+    // fractional bits
+    check_block(SENSOR_FILTER_MEDIAN, (const uint16_t[]) { 4, 1, 3, 2 }, 4,
+                (5 << SENSOR_FILTER_FRACTION_BITS) / 2);
+    check_block(SENSOR_FILTER_MEDIAN, (const uint16_t[]) { 7, 0 }, 2,
+                (7 << SENSOR_FILTER_FRACTION_BITS) / 2);
+    check_block(SENSOR_FILTER_MEDIAN, (const uint16_t[]) { 9, 9, 1, 9, 1 }, 5,
+                9 << SENSOR_FILTER_FRACTION_BITS);
+
+    // the largest block the fractional bits are sized for cannot overflow
+    for (size_t i = 0; i < 256; i++) {
+        block[i] = 4095;
+    }
+    HOST_TEST_ASSERT(sensor_filter_apply(SENSOR_FILTER_AVERAGE, block, 256)
+                     == 4095 << SENSOR_FILTER_FRACTION_BITS);
+    HOST_TEST_ASSERT(sensor_filter_apply(SENSOR_FILTER_MEDIAN, block, 256)
+                     == 4095 << SENSOR_FILTER_FRACTION_BITS);
+}
+
+int main(void) {
+    uint32_t seed = 0x35f17e2d;
+
+    test_rounding();
+
+    host_adc_set_source(replay_trace, &trace);
+    HOST_TEST_ASSERT(!lm35_adc_init(1u << LM35_CHANNEL, 1000));
+    for (int kind = 0; kind < TRACE_COUNT; kind++) {
+        make_trace(&seed, (trace_kind_t) kind);
+        for (size_t count = 1; count <= LM35_ADC_MAX_FETCH; count++) {
+            check_trace(SENSOR_FILTER_AVERAGE, count);
+            check_trace(SENSOR_FILTER_MEDIAN, count);
+        }
+    }
+    lm35_adc_release();
+    return 0;
+}
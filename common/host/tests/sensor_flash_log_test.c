@@ -0,0 +1,127 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* sensor_flash_log across simulated reboots: every reopening of the log
+ * starts a new boot with another power-up time, and the records left unsent
+ * by the previous boots must be drained, oldest first, with the timestamps
+ * they were appended with.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/flash.h"
+#include "pico/stdlib.h"
+
+#include "host_test.h"
+#include "sensor_flash_log.h"
+
+#define LOG_SECTORS 4
+#define LOG_SIZE (LOG_SECTORS * FLASH_SECTOR_SIZE)
+#define LOG_OFFSET (PICO_FLASH_SIZE_BYTES - LOG_SIZE)
+#define BOOTS 6
+/* more than the log can hold */
+#define MAX_EXPECTED (LOG_SIZE / 16)
+
+/* Unsent records, oldest first, as they should be read back */
+static sensor_flash_log_record_t expected[MAX_EXPECTED];
+static size_t expected_first;
+static size_t expected_count;
+
+static void expect(const sensor_flash_log_record_t *record) {
+    HOST_TEST_ASSERT(expected_count < MAX_EXPECTED);
+    expected[(expected_first + expected_count++) % MAX_EXPECTED] = *record;
+}
+
+static void forget_oldest(size_t count) {
+    HOST_TEST_ASSERT(count <= expected_count);
+    expected_first = (expected_first + count) % MAX_EXPECTED;
+    expected_count -= count;
+}
+
+/* Reads up to limit unsent records, checking them against the expected ones,
+ * and marks them as sent if requested */
+static size_t drain(sensor_flash_log_t *log, size_t limit, bool mark_sent) {
+    sensor_flash_log_cursor_t cursor;
+    sensor_flash_log_record_t record;
+    size_t count = 0;
+    sensor_flash_log_begin(log, &cursor);
+    while (count < limit && !sensor_flash_log_next(log, &cursor, &record)) {
+        HOST_TEST_ASSERT(count < expected_count);
+        const sensor_flash_log_record_t *exp =
+                &expected[(expected_first + count) % MAX_EXPECTED];
+        HOST_TEST_ASSERT(record.timestamp_ms == exp->timestamp_ms);
+        HOST_TEST_ASSERT(record.value == exp->value);
+        HOST_TEST_ASSERT(record.oid == exp->oid);
+        HOST_TEST_ASSERT(record.iid == exp->iid);
+        count++;
+    }
+    if (mark_sent) {
+        const size_t pending = sensor_flash_log_pending(log);
+        HOST_TEST_ASSERT(!sensor_flash_log_mark_sent(log, &cursor));
+        HOST_TEST_ASSERT(sensor_flash_log_pending(log) == pending - count);
+        forget_oldest(count);
+    }
+    return count;
+}
+
+int main(void) {
+    uint32_t seed = 0x20bd5a11;
+    int64_t previous_boot_time_ms = 0;
+
+    for (uint32_t boot = 0; boot < BOOTS; boot++) {
+        // every boot is opened at another uptime, so its power-up time on
+        // the real time clock differs from that of the previous one
+        host_time_freeze(1000000 + (uint64_t) boot * 3600000000u
+                         + host_test_rand(&seed) % 1000000);
+        sensor_flash_log_t log;
+        HOST_TEST_ASSERT(!sensor_flash_log_open(&log, LOG_OFFSET, LOG_SIZE));
+        HOST_TEST_ASSERT(!boot || log.boot_time_ms != previous_boot_time_ms);
+        previous_boot_time_ms = log.boot_time_ms;
+
+        // everything left unsent by the previous boots is recovered
+        HOST_TEST_ASSERT(sensor_flash_log_pending(&log) == expected_count);
+        HOST_TEST_ASSERT(drain(&log, SIZE_MAX, false) == expected_count);
+
+        // up to a bit more than the whole region, so that some boots wrap
+        const uint32_t count =
+                1 + host_test_rand(&seed) % (LOG_SIZE / 16 + LOG_SIZE / 64);
+        const uint32_t send_at = host_test_rand(&seed) % count;
+        for (uint32_t i = 0; i < count; i++) {
+            const sensor_flash_log_record_t record = {
+                .timestamp_ms = log.boot_time_ms + (int64_t) i * 1000 + 7,
+                .value = (int32_t) (boot << 16 | i),
+                .oid = 3303,
+                .iid = (anjay_iid_t) boot
+            };
+            const uint32_t dropped = log.stats.records_dropped;
+            HOST_TEST_ASSERT(!sensor_flash_log_append(&log, &record));
+            // records dropped because the log was full are the oldest ones
+            forget_oldest(log.stats.records_dropped - dropped);
+            expect(&record);
+
+            // a part of the records is sent, possibly spanning several boots
+            if (i == send_at) {
+                drain(&log, host_test_rand(&seed) % (expected_count + 1),
+                      true);
+            }
+        }
+        HOST_TEST_ASSERT(sensor_flash_log_pending(&log) == expected_count);
+        HOST_TEST_ASSERT(drain(&log, SIZE_MAX, false) == expected_count);
+    }
+    HOST_TEST_ASSERT(expected_count > 0);
+    return 0;
+}
@@ -0,0 +1,494 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Bytes on air per sample and encoding cost of sensor_history batches, as a
+ * function of the batch size (TEMPERATURE_SENSOR_HISTORY_SIZE and friends).
+ *
+ * The batches are built by sensor_history and sent by Anjay, over a loopback
+ * UDP connection, to a minimal LwM2M server running in the same task. The
+ * server registers the client and acknowledges every Send request, including
+ * each Block1 transfer of the larger ones, and measures the CoAP messages
+ * exchanged for each batch. The client uses NoSec here, so every datagram is
+ * then wrapped in the overhead of DTLS 1.2 with AES-128-CCM-8, UDP/IPv4 and
+ * 802.11. Airtime is computed for the PHY rate and per-frame channel access
+ * time below; change them to match the network.
+ *
+ * The encoding cost is the time spent in sensor_history_flush() and in the
+ * Anjay jobs and handlers run until the batch is confirmed, which includes
+ * the SenML CBOR encoding and sending, but not the server. */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <anjay/anjay.h>
+#include <anjay/security.h>
+#include <anjay/server.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_socket.h>
+
+#include "host_test.h"
+#include "sensor_history.h"
+
+/* 802.11n MCS0, 20 MHz */
+#ifndef BENCHMARK_PHY_RATE_KBPS
+#    define BENCHMARK_PHY_RATE_KBPS 6500
+#endif
+
+/* DIFS, average backoff, PLCP preamble, SIFS and the link layer ACK */
+#ifndef BENCHMARK_FRAME_ACCESS_US
+#    define BENCHMARK_FRAME_ACCESS_US 200
+#endif
+
+/* 802.11 MAC header, FCS and LLC/SNAP; IPv4 and UDP headers */
+#define LINK_OVERHEAD (24 + 4 + 8 + 20 + 8)
+/* record header, explicit nonce and the CCM-8 tag */
+#define DTLS_OVERHEAD (13 + 8 + 8)
+
+#define SSID 1
+#define TEMPERATURE_OID 3303
+#define SENSOR_VALUE_RID 5700
+
+#define MAX_BATCH 200
+#define ITERATIONS 20
+#define MAX_SOCKETS 4
+#define TIMEOUT_US 10000000
+#define BENCHMARK_TASK_SIZE (configMINIMAL_STACK_SIZE * 16)
+
+static const size_t BATCH_SIZES[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+
+#define COAP_VERSION 1
+#define COAP_TYPE_CON 0
+#define COAP_TYPE_ACK 2
+#define COAP_MAX_TOKEN_SIZE 8
+#define COAP_PAYLOAD_MARKER 0xFF
+
+#define COAP_CODE_CREATED 0x41
+#define COAP_CODE_DELETED 0x42
+#define COAP_CODE_CHANGED 0x44
+#define COAP_CODE_CONTINUE 0x5F
+#define COAP_CODE_DELETE 0x04
+
+#define COAP_OPTION_LOCATION_PATH 8
+#define COAP_OPTION_URI_PATH 11
+#define COAP_OPTION_BLOCK1 27
+/* "more" flag of the Block1 option value */
+#define COAP_BLOCK_MORE 0x08
+
+typedef struct {
+    uint8_t type;
+    uint8_t code;
+    uint16_t msg_id;
+    uint8_t token[COAP_MAX_TOKEN_SIZE];
+    size_t token_len;
+    /* first Uri-Path segment */
+    char uri_path[8];
+    bool has_block1;
+    uint32_t block1;
+    /* 0 if there is no payload */
+    size_t payload_offset;
+} coap_msg_t;
+
+typedef struct {
+    int fd;
+    bool registered;
+    /* Send requests received and responses sent since the last reset, and the
+     * bytes they would take on air */
+    size_t messages;
+    size_t coap_bytes;
+    size_t payload_bytes;
+    size_t air_bytes;
+    double airtime_us;
+} server_t;
+
+static anjay_t *anjay;
+static server_t server;
+static sensor_history_entry_t history_entries[MAX_BATCH + 1];
+static sensor_history_t history;
+
+static int read_option_ext(const uint8_t *buf,
+                           size_t len,
+                           size_t *inout_pos,
+                           unsigned *inout_value) {
+    if (*inout_value == 13) {
+        if (*inout_pos + 1 > len) {
+            return -1;
+        }
+        *inout_value = 13u + buf[(*inout_pos)++];
+    } else if (*inout_value == 14) {
+        if (*inout_pos + 2 > len) {
+            return -1;
+        }
+        *inout_value = 269u + (unsigned) (buf[*inout_pos] << 8)
+                       + buf[*inout_pos + 1];
+        *inout_pos += 2;
+    } else if (*inout_value == 15) {
+        return -1;
+    }
+    return 0;
+}
+
+static int coap_parse(const uint8_t *buf, size_t len, coap_msg_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (len < 4 || buf[0] >> 6 != COAP_VERSION) {
+        return -1;
+    }
+    out->type = (buf[0] >> 4) & 0x03;
+    out->token_len = buf[0] & 0x0F;
+    out->code = buf[1];
+    out->msg_id = (uint16_t) ((buf[2] << 8) | buf[3]);
+    if (out->token_len > COAP_MAX_TOKEN_SIZE || 4 + out->token_len > len) {
+        return -1;
+    }
+    memcpy(out->token, &buf[4], out->token_len);
+
+    size_t pos = 4 + out->token_len;
+    unsigned number = 0;
+    while (pos < len && buf[pos] != COAP_PAYLOAD_MARKER) {
+        unsigned delta = buf[pos] >> 4;
+        unsigned option_len = buf[pos] & 0x0F;
+        ++pos;
+        if (read_option_ext(buf, len, &pos, &delta)
+                || read_option_ext(buf, len, &pos, &option_len)
+                || pos + option_len > len) {
+            return -1;
+        }
+        number += delta;
+        if (number == COAP_OPTION_URI_PATH && !out->uri_path[0]
+                && option_len < sizeof(out->uri_path)) {
+            memcpy(out->uri_path, &buf[pos], option_len);
+        } else if (number == COAP_OPTION_BLOCK1 && option_len <= 3) {
+            out->has_block1 = true;
+            for (size_t i = 0; i < option_len; i++) {
+                out->block1 = (out->block1 << 8) | buf[pos + i];
+            }
+        }
+        pos += option_len;
+    }
+    if (pos + 1 < len) {
+        out->payload_offset = pos + 1;
+    }
+    return 0;
+}
+
+/* Appends an option; deltas and lengths are small enough for at most one
+ * extension byte */
+static uint8_t *coap_add_option(uint8_t *out,
+                                unsigned *inout_number,
+                                unsigned number,
+                                const uint8_t *value,
+                                size_t len) {
+    const unsigned delta = number - *inout_number;
+    *inout_number = number;
+    *out++ = (uint8_t) (((delta < 13 ? delta : 13) << 4) | len);
+    if (delta >= 13) {
+        *out++ = (uint8_t) (delta - 13);
+    }
+    memcpy(out, value, len);
+    return out + len;
+}
+
+static size_t coap_build_response(uint8_t *buf,
+                                  const coap_msg_t *request,
+                                  uint8_t code) {
+    uint8_t *out = buf;
+    *out++ = (uint8_t) ((COAP_VERSION << 6) | (COAP_TYPE_ACK << 4)
+                        | request->token_len);
+    *out++ = code;
+    *out++ = (uint8_t) (request->msg_id >> 8);
+    *out++ = (uint8_t) request->msg_id;
+    memcpy(out, request->token, request->token_len);
+    out += request->token_len;
+
+    unsigned number = 0;
+    if (code == COAP_CODE_CREATED) {
+        out = coap_add_option(out, &number, COAP_OPTION_LOCATION_PATH,
+                              (const uint8_t *) "rd", 2);
+        out = coap_add_option(out, &number, COAP_OPTION_LOCATION_PATH,
+                              (const uint8_t *) "0", 1);
+    }
+    if (request->has_block1) {
+        // the acknowledged block, with the minimal number of bytes
+        uint8_t value[3];
+        size_t len = 0;
+        for (int shift = 16; shift >= 0; shift -= 8) {
+            if (len || ((request->block1 >> shift) & 0xFF)) {
+                value[len++] = (uint8_t) (request->block1 >> shift);
+            }
+        }
+        out = coap_add_option(out, &number, COAP_OPTION_BLOCK1, value, len);
+    }
+    return (size_t) (out - buf);
+}
+
+static void server_count(size_t coap_size) {
+    const size_t datagram_size = LINK_OVERHEAD + DTLS_OVERHEAD + coap_size;
+    server.messages++;
+    server.coap_bytes += coap_size;
+    server.air_bytes += datagram_size;
+    server.airtime_us += BENCHMARK_FRAME_ACCESS_US
+                         + (double) datagram_size * 8000.0
+                                   / BENCHMARK_PHY_RATE_KBPS;
+}
+
+static void server_reset_stats(void) {
+    server.messages = 0;
+    server.coap_bytes = 0;
+    server.payload_bytes = 0;
+    server.air_bytes = 0;
+    server.airtime_us = 0.0;
+}
+
+static uint16_t server_open(void) {
+    server.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    HOST_TEST_ASSERT(server.fd >= 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    HOST_TEST_ASSERT(!bind(server.fd, (struct sockaddr *) &addr, addr_len));
+    HOST_TEST_ASSERT(
+            !getsockname(server.fd, (struct sockaddr *) &addr, &addr_len));
+    return ntohs(addr.sin_port);
+}
+
+static void server_handle(void) {
+    uint8_t buf[2048];
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+    const ssize_t len = recvfrom(server.fd, buf, sizeof(buf), MSG_DONTWAIT,
+                                 (struct sockaddr *) &peer, &peer_len);
+    coap_msg_t request;
+    if (len <= 0 || coap_parse(buf, (size_t) len, &request)
+            || request.type != COAP_TYPE_CON) {
+        return;
+    }
+
+    uint8_t code = COAP_CODE_CHANGED;
+    const bool is_send = !strcmp(request.uri_path, "dp");
+    if (is_send) {
+        server_count((size_t) len);
+        if (request.payload_offset) {
+            server.payload_bytes += (size_t) len - request.payload_offset;
+        }
+        if (request.has_block1 && (request.block1 & COAP_BLOCK_MORE)) {
+            code = COAP_CODE_CONTINUE;
+        }
+    } else if (!strcmp(request.uri_path, "rd") && !server.registered) {
+        code = COAP_CODE_CREATED;
+        server.registered = true;
+    } else if (request.code == COAP_CODE_DELETE) {
+        code = COAP_CODE_DELETED;
+    }
+
+    uint8_t response[64];
+    const size_t response_len = coap_build_response(response, &request, code);
+    HOST_TEST_ASSERT(sendto(server.fd, response, response_len, 0,
+                            (struct sockaddr *) &peer, peer_len)
+                     == (ssize_t) response_len);
+    if (is_send) {
+        server_count(response_len);
+    }
+}
+
+static bool is_registered(const void *unused) {
+    (void) unused;
+    return server.registered;
+}
+
+static bool is_batch_confirmed(const void *batches_sent) {
+    return history.stats.batches_sent > *(const uint32_t *) batches_sent;
+}
+
+/* Runs the client and the server until done(arg) holds; the time spent in
+ * the client is added to *inout_client_us */
+static void run_until(bool (*done)(const void *arg),
+                      const void *arg,
+                      uint64_t *inout_client_us) {
+    const uint64_t deadline_us = time_us_64() + TIMEOUT_US;
+    while (!done(arg)) {
+        HOST_TEST_ASSERT(time_us_64() < deadline_us);
+
+        struct pollfd pollfds[1 + MAX_SOCKETS] = {
+            { .fd = server.fd, .events = POLLIN }
+        };
+        avs_net_socket_t *sockets[MAX_SOCKETS];
+        size_t count = 0;
+        AVS_LIST(avs_net_socket_t *const) sock;
+        AVS_LIST_FOREACH(sock, anjay_get_sockets(anjay)) {
+            const int *fd = (const int *) avs_net_socket_get_system(*sock);
+            if (count < MAX_SOCKETS && fd) {
+                sockets[count] = *sock;
+                pollfds[1 + count].fd = *fd;
+                pollfds[1 + count].events = POLLIN;
+                count++;
+            }
+        }
+        const int wait_ms = anjay_sched_calculate_wait_time_ms(anjay, 100);
+        if (poll(pollfds, 1 + count, wait_ms) < 0) {
+            HOST_TEST_ASSERT(errno == EINTR);
+            continue;
+        }
+
+        if (pollfds[0].revents) {
+            server_handle();
+        }
+        const uint64_t start_us = time_us_64();
+        for (size_t i = 0; i < count; i++) {
+            if (pollfds[1 + i].revents) {
+                anjay_serve(anjay, sockets[i]);
+            }
+        }
+        anjay_sched_run(anjay);
+        if (inout_client_us) {
+            *inout_client_us += time_us_64() - start_us;
+        }
+    }
+}
+
+static void setup_client(uint16_t port) {
+    const anjay_configuration_t config = {
+        .endpoint_name = "airtime-benchmark",
+        .in_buffer_size = 2048,
+        .out_buffer_size = 2048,
+        .msg_cache_size = 2048
+    };
+    anjay = anjay_new(&config);
+    HOST_TEST_ASSERT(anjay);
+
+    char server_uri[32];
+    snprintf(server_uri, sizeof(server_uri), "coap://127.0.0.1:%u",
+             (unsigned) port);
+    const anjay_security_instance_t security_instance = {
+        .ssid = SSID,
+        .server_uri = server_uri,
+        .security_mode = ANJAY_SECURITY_NOSEC
+    };
+    const anjay_server_instance_t server_instance = {
+        .ssid = SSID,
+        .lifetime = 86400,
+        .default_min_period = -1,
+        .default_max_period = -1,
+        .disable_timeout = -1,
+        .binding = "U"
+    };
+    anjay_iid_t security_iid = ANJAY_ID_INVALID;
+    anjay_iid_t server_iid = ANJAY_ID_INVALID;
+    HOST_TEST_ASSERT(!anjay_security_object_install(anjay));
+    HOST_TEST_ASSERT(!anjay_security_object_add_instance(
+            anjay, &security_instance, &security_iid));
+    HOST_TEST_ASSERT(!anjay_server_object_install(anjay));
+    HOST_TEST_ASSERT(!anjay_server_object_add_instance(
+            anjay, &server_instance, &server_iid));
+}
+
+static void benchmark_task(void *unused) {
+    (void) unused;
+    avs_log_set_default_level(AVS_LOG_WARNING);
+
+    setup_client(server_open());
+    run_until(is_registered, NULL, NULL);
+
+    history = (sensor_history_t) {
+        .anjay = anjay,
+        .ssid = SSID,
+        .oid = TEMPERATURE_OID,
+        .rid = SENSOR_VALUE_RID,
+        // flushed by hand only
+        .flush_interval_ms = 0,
+        .entries = history_entries,
+        // one more than the largest batch, which is then not flushed by
+        // sensor_history_add()
+        .capacity = MAX_BATCH + 1
+    };
+    sensor_history_init(&history);
+
+    uint32_t seed = 0xC0FFEE;
+    uint64_t client_us[sizeof(BATCH_SIZES) / sizeof(BATCH_SIZES[0])] = { 0 };
+    printf("%-6s %8s %6s %10s %12s %14s\n", "batch", "payload", "msgs",
+           "air bytes", "bytes/sample", "airtime/sample");
+    double single_us = 0.0;
+    for (size_t i = 0; i < sizeof(BATCH_SIZES) / sizeof(BATCH_SIZES[0]); i++) {
+        const size_t count = BATCH_SIZES[i];
+        server_reset_stats();
+        for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+            for (size_t j = 0; j < count; j++) {
+                sensor_history_add(&history,
+                                   (anjay_iid_t) (host_test_rand(&seed) % 2),
+                                   20000
+                                           + (int32_t) (host_test_rand(&seed)
+                                                        % 10000));
+            }
+            const uint32_t batches_sent = history.stats.batches_sent;
+            const uint64_t start_us = time_us_64();
+            HOST_TEST_ASSERT(!sensor_history_flush(&history));
+            client_us[i] += time_us_64() - start_us;
+            run_until(is_batch_confirmed, &batches_sent, &client_us[i]);
+        }
+
+        const double per_batch = 1.0 / ITERATIONS;
+        const double per_sample = per_batch / (double) count;
+        if (count == 1) {
+            single_us = server.airtime_us * per_sample;
+        }
+        printf("%-6zu %8.0f %6.1f %10.0f %12.1f %11.1f us (%.1fx)\n", count,
+               (double) server.payload_bytes * per_batch,
+               (double) server.messages * per_batch,
+               (double) server.air_bytes * per_batch,
+               (double) server.air_bytes * per_sample,
+               server.airtime_us * per_sample,
+               single_us / (server.airtime_us * per_sample));
+    }
+    HOST_TEST_ASSERT(!history.stats.send_errors);
+    printf("\n");
+
+    for (size_t i = 0; i < sizeof(BATCH_SIZES) / sizeof(BATCH_SIZES[0]); i++) {
+        char label[64];
+        snprintf(label, sizeof(label), "sensor_history send, batch of %zu",
+                 BATCH_SIZES[i]);
+        host_benchmark_report(label, client_us[i],
+                              (uint64_t) ITERATIONS * BATCH_SIZES[i],
+                              "sample");
+    }
+
+    // the process ends here, without deregistering
+    exit(0);
+}
+
+int main(void) {
+    static StackType_t benchmark_task_stack[BENCHMARK_TASK_SIZE];
+    static StaticTask_t benchmark_task_buffer;
+    xTaskCreateStatic(benchmark_task, "BenchmarkTask", BENCHMARK_TASK_SIZE,
+                      NULL, tskIDLE_PRIORITY + 1, benchmark_task_stack,
+                      &benchmark_task_buffer);
+    vTaskStartScheduler();
+    return 1;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Cost per sample of the temperature pipeline with integer millidegrees, as
+ * the drivers and sensor_sample modules implement it, against the double
+ * pipeline it replaced: raw register to temperature conversion, change filter
+ * and the sliding and tumbling window aggregation.
+ *
+ * The double variant is a condensed copy of the code before the conversion.
+ * The host has an FPU, so the ratio printed here is a lower bound of the one
+ * on the Cortex-M0+, where each floating-point operation in the double
+ * variant is a soft-float library call. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "host_test.h"
+#include "sensor_aggregate.h"
+#include "sensor_change_filter.h"
+
+#define ITERATIONS 2000000
+#define WINDOW_SIZE 10
+#define INTERVAL_US 60000000
+#define SAMPLE_PERIOD_US 1000000
+#define DEADBAND_MC 100
+
+/* DS18B20, MPL3115A2 and LM35 conversions, as in the drivers */
+static int32_t convert_fixed(uint32_t sensor, int16_t raw) {
+    switch (sensor) {
+    case 0:
+        return (int32_t) raw * 1000 / 16;
+    case 1:
+        return (int32_t) raw * 1000 / 256;
+    default:
+        return (int32_t) (((uint32_t) raw & 0xFFF) * (3300 * 1000 / 10)
+                          + 4096 / 2)
+               / 4096;
+    }
+}
+
+static double convert_double(uint32_t sensor, int16_t raw) {
+    switch (sensor) {
+    case 0:
+        return raw / 16.0;
+    case 1:
+        return (double) ((float) raw / 256.f);
+    default:
+        return (double) ((uint32_t) raw & 0xFFF) * (3300. / 4096.) / 10.;
+    }
+}
+
+typedef struct {
+    double deadband;
+    bool has_reference;
+    double reference;
+    double min_value;
+    double max_value;
+} double_filter_t;
+
+static bool double_filter_check(double_filter_t *filter, double value) {
+    bool pass = !filter->has_reference || value < filter->min_value
+                || value > filter->max_value;
+    if (!pass) {
+        const double diff = value - filter->reference;
+        pass = (diff < 0.0 ? -diff : diff) >= filter->deadband;
+    }
+    if (!pass) {
+        return false;
+    }
+    if (!filter->has_reference) {
+        filter->min_value = value;
+        filter->max_value = value;
+        filter->has_reference = true;
+    } else if (value < filter->min_value) {
+        filter->min_value = value;
+    } else if (value > filter->max_value) {
+        filter->max_value = value;
+    }
+    filter->reference = value;
+    return true;
+}
+
+#define SLOT(Seq) ((Seq) % SENSOR_AGGREGATE_MAX_WINDOW)
+
+/* Running sums with periodic recomputation, monotonic queues for min/max */
+typedef struct {
+    uint32_t size;
+    double values[SENSOR_AGGREGATE_MAX_WINDOW];
+    uint32_t next_seq;
+    uint32_t count;
+    double sum;
+    double sum_sq;
+    uint32_t min_queue[SENSOR_AGGREGATE_MAX_WINDOW];
+    uint32_t min_first;
+    uint32_t min_len;
+    uint32_t max_queue[SENSOR_AGGREGATE_MAX_WINDOW];
+    uint32_t max_first;
+    uint32_t max_len;
+} double_sliding_t;
+
+static void double_queue_push(double_sliding_t *window,
+                              uint32_t *queue,
+                              uint32_t first,
+                              uint32_t *len,
+                              uint32_t seq,
+                              bool is_min) {
+    const double value = window->values[SLOT(seq)];
+    while (*len) {
+        const double back =
+                window->values[SLOT(queue[SLOT(first + *len - 1)])];
+        if (is_min ? back < value : back > value) {
+            break;
+        }
+        --*len;
+    }
+    queue[SLOT(first + (*len)++)] = seq;
+}
+
+static void double_sliding_add(double_sliding_t *window, double value) {
+    const uint32_t seq = window->next_seq++;
+    if (window->count == window->size) {
+        const uint32_t expired_seq = seq - window->size;
+        const double expired = window->values[SLOT(expired_seq)];
+        window->sum -= expired;
+        window->sum_sq -= expired * expired;
+        window->count--;
+        if (window->min_len
+                && window->min_queue[window->min_first] == expired_seq) {
+            window->min_first = SLOT(window->min_first + 1);
+            window->min_len--;
+        }
+        if (window->max_len
+                && window->max_queue[window->max_first] == expired_seq) {
+            window->max_first = SLOT(window->max_first + 1);
+            window->max_len--;
+        }
+    }
+    window->values[SLOT(seq)] = value;
+    window->count++;
+    double_queue_push(window, window->min_queue, window->min_first,
+                      &window->min_len, seq, true);
+    double_queue_push(window, window->max_queue, window->max_first,
+                      &window->max_len, seq, false);
+    if (window->next_seq % window->size == 0) {
+        window->sum = 0.0;
+        window->sum_sq = 0.0;
+        for (uint32_t i = 0; i < window->count; i++) {
+            const double v =
+                    window->values[SLOT(window->next_seq - window->count + i)];
+            window->sum += v;
+            window->sum_sq += v * v;
+        }
+    } else {
+        window->sum += value;
+        window->sum_sq += value * value;
+    }
+}
+
+/* Welford's algorithm */
+typedef struct {
+    uint64_t start_us;
+    uint32_t count;
+    double min;
+    double max;
+    double mean;
+    double m2;
+    double last_mean;
+    double last_variance;
+} double_tumbling_t;
+
+static bool
+double_tumbling_add(double_tumbling_t *window, uint64_t now_us, double value) {
+    bool completed = false;
+    if (window->count && now_us - window->start_us >= INTERVAL_US) {
+        window->last_mean = window->mean;
+        window->last_variance = window->m2 / window->count;
+        window->count = 0;
+        completed = true;
+    }
+    if (!window->count) {
+        window->start_us = now_us;
+        window->min = value;
+        window->max = value;
+        window->mean = 0.0;
+        window->m2 = 0.0;
+    } else if (value < window->min) {
+        window->min = value;
+    } else if (value > window->max) {
+        window->max = value;
+    }
+    window->count++;
+    const double delta = value - window->mean;
+    window->mean += delta / window->count;
+    window->m2 += delta * (value - window->mean);
+    return completed;
+}
+
+/* Raw readings of a slowly drifting temperature with some noise, the same for
+ * both variants */
+static int16_t raw_reading(uint32_t i, uint32_t *seed) {
+    return (int16_t) (350 + (i / 64) % 64 + host_test_rand(seed) % 4);
+}
+
+static void run_fixed(uint32_t sensor) {
+    sensor_change_filter_t filter;
+    sensor_sliding_window_t sliding;
+    sensor_tumbling_window_t tumbling;
+    sensor_change_filter_init(&filter, DEADBAND_MC);
+    sensor_sliding_window_reset(&sliding, WINDOW_SIZE);
+    sensor_tumbling_window_reset(&tumbling, INTERVAL_US);
+
+    uint32_t seed = 0xC0FFEE;
+    // accumulated so that the calls cannot be optimized out
+    volatile uint32_t sink = 0;
+    const uint64_t start_us = time_us_64();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        const int32_t value = convert_fixed(sensor, raw_reading(i, &seed));
+        sink += sensor_change_filter_check(&filter, true, value);
+        sensor_sliding_window_add(&sliding, value);
+        sink += sensor_tumbling_window_add(
+                &tumbling, (uint64_t) i * SAMPLE_PERIOD_US, value);
+    }
+    const uint64_t elapsed_us = time_us_64() - start_us;
+
+    char label[64];
+    snprintf(label, sizeof(label), "int32 millidegrees, sensor %u",
+             (unsigned) sensor);
+    host_benchmark_report(label, elapsed_us, ITERATIONS, "sample");
+    (void) sink;
+}
+
+static void run_double(uint32_t sensor) {
+    double_filter_t filter = {
+        .deadband = DEADBAND_MC / 1000.0
+    };
+    double_sliding_t sliding = {
+        .size = WINDOW_SIZE
+    };
+    double_tumbling_t tumbling = { 0 };
+
+    uint32_t seed = 0xC0FFEE;
+    volatile uint32_t sink = 0;
+    const uint64_t start_us = time_us_64();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        const double value = convert_double(sensor, raw_reading(i, &seed));
+        sink += double_filter_check(&filter, value);
+        double_sliding_add(&sliding, value);
+        sink += double_tumbling_add(&tumbling, (uint64_t) i * SAMPLE_PERIOD_US,
+                                    value);
+    }
+    const uint64_t elapsed_us = time_us_64() - start_us;
+
+    char label[64];
+    snprintf(label, sizeof(label), "double degrees, sensor %u",
+             (unsigned) sensor);
+    host_benchmark_report(label, elapsed_us, ITERATIONS, "sample");
+    (void) sink;
+}
+
+int main(void) {
+    // 0: DS18B20, 1: MPL3115A2, 2: LM35
+    for (uint32_t sensor = 0; sensor < 3; sensor++) {
+        run_double(sensor);
+        run_fixed(sensor);
+    }
+    return 0;
+}
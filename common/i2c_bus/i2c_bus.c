@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "i2c_bus.h"
+
+static void transfer_done(i2c_bus_transaction_t *transaction) {
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t) transaction->arg, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+int i2c_bus_transfer(uint8_t addr,
+                     const uint8_t *tx,
+                     size_t tx_len,
+                     uint8_t *rx,
+                     size_t rx_len,
+                     uint32_t timeout_ms) {
+    StaticSemaphore_t done_buffer;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&done_buffer);
+
+    i2c_bus_transaction_t transaction = {
+        .addr = addr,
+        .tx = tx,
+        .tx_len = tx_len,
+        .rx = rx,
+        .rx_len = rx_len,
+        .done = transfer_done,
+        .arg = done
+    };
+    if (i2c_bus_submit(&transaction)) {
+        return -1;
+    }
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        // after this, the interrupt no longer refers to the transaction or
+        // the semaphore, both of which are on this stack
+        i2c_bus_cancel(&transaction);
+        return PICO_ERROR_TIMEOUT;
+    }
+    return transaction.result;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hardware/i2c.h>
+
+/**
+ * Shared I2C bus with a queue of transactions, so that several drivers can
+ * use it from any task without spinning on the bus or holding locks while a
+ * transfer is in progress.
+ *
+ * The transport comes from a backend selected at build time:
+ * i2c_bus_dma.c moves the data with DMA and completes transactions from the
+ * I2C interrupt on the device, and i2c_bus_host.c runs them synchronously on
+ * the host I2C stand-in, which routes them to simulated devices.
+ */
+
+/* Maximum number of bytes written and read in a single transaction */
+#ifndef I2C_BUS_MAX_TRANSFER
+#    define I2C_BUS_MAX_TRANSFER 256
+#endif
+
+typedef struct i2c_bus_transaction_struct i2c_bus_transaction_t;
+
+/**
+ * Called when a transaction has completed or failed, from the I2C interrupt
+ * on the device, and on the host from i2c_bus_submit() or, in deferred mode,
+ * i2c_bus_host_complete_next().
+ */
+typedef void i2c_bus_done_cb_t(i2c_bus_transaction_t *transaction);
+
+struct i2c_bus_transaction_struct {
+    /* 7-bit address */
+    uint8_t addr;
+    /* written first, then rx_len bytes are read after a repeated start; at
+     * least one of the lengths must be nonzero */
+    const uint8_t *tx;
+    size_t tx_len;
+    uint8_t *rx;
+    size_t rx_len;
+    i2c_bus_done_cb_t *done;
+    void *arg;
+
+    /* set before done is called: 0 on success, a negative value if the
+     * device did not acknowledge or the transaction was cancelled */
+    int result;
+    /* next transaction in the queue, owned by the bus */
+    i2c_bus_transaction_t *next;
+};
+
+int i2c_bus_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_bus_release(void);
+
+/**
+ * Appends the transaction to the queue; it is started as soon as the bus is
+ * free. The transaction must stay valid until done is called or
+ * i2c_bus_cancel() returns. Returns a negative value if the transaction is
+ * invalid or the bus is not initialized, in which case done is not called.
+ */
+int i2c_bus_submit(i2c_bus_transaction_t *transaction);
+
+/**
+ * Removes the transaction from the queue, aborting it if it is in progress.
+ * If done is being called at the same time, e.g. by the interrupt on the other
+ * core, waits for it to return. done is not called afterwards.
+ */
+void i2c_bus_cancel(i2c_bus_transaction_t *transaction);
+
+/**
+ * Runs a transaction and blocks the calling task, without using the CPU,
+ * until it completes or timeout_ms passes. Returns 0 on success.
+ */
+int i2c_bus_transfer(uint8_t addr,
+                     const uint8_t *tx,
+                     size_t tx_len,
+                     uint8_t *rx,
+                     size_t rx_len,
+                     uint32_t timeout_ms);
@@ -0,0 +1,259 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <pico/stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "i2c_bus.h"
+
+/**
+ * Device backend. The whole transaction is expressed as a sequence of
+ * IC_DATA_CMD words (bytes to write, then read commands with a restart on the
+ * first and a stop on the last one), which one DMA channel feeds to the
+ * controller while another one collects the received bytes. The controller
+ * raises STOP_DET when the transaction has ended, successfully or not, and
+ * the interrupt handler completes it and starts the next one from the queue.
+ */
+
+static i2c_inst_t *bus_i2c;
+static uint bus_baudrate;
+static int tx_dma = -1;
+static int rx_dma = -1;
+
+/* Transaction in progress, and the queue of the ones waiting for the bus */
+static i2c_bus_transaction_t *current;
+static i2c_bus_transaction_t *queue_head;
+static i2c_bus_transaction_t *queue_tail;
+/* Result of the transaction in progress, set on TX_ABRT */
+static int current_result;
+/* Transaction whose done callback is running; the interrupt calls it outside
+ * of the critical section, so i2c_bus_cancel() on the other core has to wait
+ * for it to return */
+static i2c_bus_transaction_t *volatile completing;
+
+static uint16_t commands[I2C_BUS_MAX_TRANSFER];
+
+static uint bus_irq(void) {
+    return i2c_hw_index(bus_i2c) ? I2C1_IRQ : I2C0_IRQ;
+}
+
+static void configure_controller(void) {
+    i2c_init(bus_i2c, bus_baudrate);
+    i2c_hw_t *hw = i2c_get_hw(bus_i2c);
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS
+                    | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+}
+
+static void start(i2c_bus_transaction_t *transaction) {
+    i2c_hw_t *hw = i2c_get_hw(bus_i2c);
+    current = transaction;
+    current_result = 0;
+
+    size_t len = 0;
+    for (size_t i = 0; i < transaction->tx_len; i++) {
+        commands[len++] = transaction->tx[i];
+    }
+    for (size_t i = 0; i < transaction->rx_len; i++) {
+        commands[len++] = I2C_IC_DATA_CMD_CMD_BITS
+                          | (i == 0 && transaction->tx_len
+                                     ? I2C_IC_DATA_CMD_RESTART_BITS
+                                     : 0);
+    }
+    commands[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // the target address may only be changed while the controller is
+    // disabled
+    hw->enable = 0;
+    hw->tar = transaction->addr;
+    hw->enable = 1;
+    (void) hw->clr_intr;
+
+    if (transaction->rx_len) {
+        dma_channel_config config =
+                dma_channel_get_default_config((uint) rx_dma);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, true);
+        channel_config_set_dreq(&config, i2c_get_dreq(bus_i2c, false));
+        dma_channel_configure((uint) rx_dma, &config, transaction->rx,
+                              &hw->data_cmd, transaction->rx_len, true);
+    }
+
+    dma_channel_config config = dma_channel_get_default_config((uint) tx_dma);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(bus_i2c, true));
+    dma_channel_configure((uint) tx_dma, &config, &hw->data_cmd, commands,
+                          len, true);
+}
+
+/* Must be called with the queue locked */
+static void start_next(void) {
+    current = NULL;
+    if (queue_head) {
+        i2c_bus_transaction_t *next = queue_head;
+        queue_head = next->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        start(next);
+    }
+}
+
+static void i2c_irq_handler(void) {
+    i2c_hw_t *hw = i2c_get_hw(bus_i2c);
+    const uint32_t status = hw->intr_stat;
+
+    const UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // e.g. a NACK; the controller flushes the commands and issues a stop,
+        // which completes the transaction below
+        (void) hw->clr_tx_abrt;
+        dma_channel_abort((uint) tx_dma);
+        dma_channel_abort((uint) rx_dma);
+        current_result = -1;
+    }
+
+    i2c_bus_transaction_t *finished = NULL;
+    if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void) hw->clr_stop_det;
+        if (current) {
+            // all bytes are in the RX FIFO at this point, DMA only needs a
+            // few more cycles to move them
+            while (!current_result && dma_channel_is_busy((uint) rx_dma)) {
+                tight_loop_contents();
+            }
+            finished = current;
+            finished->result = current_result;
+            completing = finished;
+            start_next();
+        }
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+
+    if (finished) {
+        if (finished->done) {
+            finished->done(finished);
+        }
+        const UBaseType_t saved_again = taskENTER_CRITICAL_FROM_ISR();
+        completing = NULL;
+        taskEXIT_CRITICAL_FROM_ISR(saved_again);
+    }
+}
+
+int i2c_bus_init(i2c_inst_t *i2c, uint baudrate) {
+    if (tx_dma < 0 && (tx_dma = dma_claim_unused_channel(false)) < 0) {
+        return -1;
+    }
+    if (rx_dma < 0 && (rx_dma = dma_claim_unused_channel(false)) < 0) {
+        return -1;
+    }
+
+    bus_i2c = i2c;
+    bus_baudrate = baudrate;
+    configure_controller();
+    irq_set_exclusive_handler(bus_irq(), i2c_irq_handler);
+    irq_set_enabled(bus_irq(), true);
+    return 0;
+}
+
+void i2c_bus_release(void) {
+    if (!bus_i2c) {
+        return;
+    }
+    irq_set_enabled(bus_irq(), false);
+    irq_remove_handler(bus_irq(), i2c_irq_handler);
+    i2c_deinit(bus_i2c);
+    bus_i2c = NULL;
+
+    dma_channel_abort((uint) tx_dma);
+    dma_channel_abort((uint) rx_dma);
+    dma_channel_unclaim((uint) tx_dma);
+    dma_channel_unclaim((uint) rx_dma);
+    tx_dma = -1;
+    rx_dma = -1;
+    current = NULL;
+    queue_head = NULL;
+    queue_tail = NULL;
+    completing = NULL;
+}
+
+int i2c_bus_submit(i2c_bus_transaction_t *transaction) {
+    if (!bus_i2c || !transaction
+            || (!transaction->tx_len && !transaction->rx_len)
+            || transaction->tx_len + transaction->rx_len
+                           > I2C_BUS_MAX_TRANSFER) {
+        return -1;
+    }
+
+    transaction->next = NULL;
+    taskENTER_CRITICAL();
+    if (!current) {
+        start(transaction);
+    } else if (queue_tail) {
+        queue_tail->next = transaction;
+        queue_tail = transaction;
+    } else {
+        queue_head = queue_tail = transaction;
+    }
+    taskEXIT_CRITICAL();
+    return 0;
+}
+
+void i2c_bus_cancel(i2c_bus_transaction_t *transaction) {
+    taskENTER_CRITICAL();
+    while (transaction == completing) {
+        // the interrupt on the other core has already finished the
+        // transaction and is calling done, which only takes a moment; the
+        // transaction is neither current nor queued any more
+        taskEXIT_CRITICAL();
+        tight_loop_contents();
+        taskENTER_CRITICAL();
+    }
+    if (transaction == current) {
+        // the bus is probably stuck; resetting the controller is the only
+        // way to make sure no stale interrupt completes the next transaction
+        irq_set_enabled(bus_irq(), false);
+        dma_channel_abort((uint) tx_dma);
+        dma_channel_abort((uint) rx_dma);
+        configure_controller();
+        irq_clear(bus_irq());
+        irq_set_enabled(bus_irq(), true);
+        start_next();
+    } else {
+        i2c_bus_transaction_t **link = &queue_head;
+        i2c_bus_transaction_t *previous = NULL;
+        while (*link && *link != transaction) {
+            previous = *link;
+            link = &(*link)->next;
+        }
+        if (*link) {
+            *link = transaction->next;
+            if (queue_tail == transaction) {
+                queue_tail = previous;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+
+#include "i2c_bus.h"
+#include "i2c_bus_host.h"
+
+/**
+ * Host backend: transactions run on the I2C stand-in, either as soon as they
+ * are submitted or, in deferred mode, when i2c_bus_host_complete_next() is
+ * called. The queue is protected by a mutex, which stands for the critical
+ * section of the device backend, and cancellation follows the same rules.
+ */
+
+static i2c_inst_t *bus_i2c;
+static bool deferred;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static i2c_bus_transaction_t *queue_head;
+static i2c_bus_transaction_t *queue_tail;
+/* Transaction being run or whose done callback is running */
+static i2c_bus_transaction_t *completing;
+
+int i2c_bus_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c_init(i2c, baudrate);
+    bus_i2c = i2c;
+    return 0;
+}
+
+void i2c_bus_release(void) {
+    if (bus_i2c) {
+        i2c_deinit(bus_i2c);
+        bus_i2c = NULL;
+    }
+    pthread_mutex_lock(&queue_mutex);
+    queue_head = NULL;
+    queue_tail = NULL;
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+static void run(i2c_bus_transaction_t *transaction) {
+    const bool has_rx = transaction->rx_len > 0;
+    int result = 0;
+    if (transaction->tx_len
+            && i2c_write_blocking(bus_i2c, transaction->addr, transaction->tx,
+                                  transaction->tx_len, has_rx)
+                           != (int) transaction->tx_len) {
+        result = -1;
+    }
+    if (!result && has_rx
+            && i2c_read_blocking(bus_i2c, transaction->addr, transaction->rx,
+                                 transaction->rx_len, false)
+                           != (int) transaction->rx_len) {
+        result = -1;
+    }
+
+    transaction->result = result;
+    if (transaction->done) {
+        transaction->done(transaction);
+    }
+}
+
+int i2c_bus_submit(i2c_bus_transaction_t *transaction) {
+    if (!bus_i2c || !transaction
+            || (!transaction->tx_len && !transaction->rx_len)
+            || transaction->tx_len + transaction->rx_len
+                           > I2C_BUS_MAX_TRANSFER) {
+        return -1;
+    }
+
+    transaction->next = NULL;
+    if (!deferred) {
+        run(transaction);
+        return 0;
+    }
+
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_tail) {
+        queue_tail->next = transaction;
+        queue_tail = transaction;
+    } else {
+        queue_head = queue_tail = transaction;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+    return 0;
+}
+
+void i2c_bus_cancel(i2c_bus_transaction_t *transaction) {
+    pthread_mutex_lock(&queue_mutex);
+    while (transaction == completing) {
+        pthread_mutex_unlock(&queue_mutex);
+        sched_yield();
+        pthread_mutex_lock(&queue_mutex);
+    }
+    i2c_bus_transaction_t **link = &queue_head;
+    i2c_bus_transaction_t *previous = NULL;
+    while (*link && *link != transaction) {
+        previous = *link;
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = transaction->next;
+        if (queue_tail == transaction) {
+            queue_tail = previous;
+        }
+    }
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+void i2c_bus_host_set_deferred(bool value) {
+    deferred = value;
+}
+
+bool i2c_bus_host_complete_next(void) {
+    pthread_mutex_lock(&queue_mutex);
+    i2c_bus_transaction_t *transaction = queue_head;
+    if (transaction) {
+        queue_head = transaction->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        completing = transaction;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+    if (!transaction) {
+        return false;
+    }
+
+    run(transaction);
+
+    pthread_mutex_lock(&queue_mutex);
+    completing = NULL;
+    pthread_mutex_unlock(&queue_mutex);
+    return true;
+}
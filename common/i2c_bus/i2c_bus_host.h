@@ -0,0 +1,38 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * Test hooks of the host backend of the I2C bus (i2c_bus_host.c).
+ *
+ * By default, transactions run to completion as soon as they are submitted.
+ * In deferred mode, i2c_bus_submit() only queues them, and
+ * i2c_bus_host_complete_next() runs the oldest one and calls its done
+ * callback, standing in for the transfer and the I2C interrupt. Calling it
+ * from another thread reproduces the device, where the interrupt may complete
+ * a transaction on one core while a task times out on it on the other.
+ */
+
+void i2c_bus_host_set_deferred(bool deferred);
+
+/**
+ * Runs the oldest queued transaction and calls its done callback. Returns
+ * false if the queue was empty.
+ */
+bool i2c_bus_host_complete_next(void);
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "sensor_aggregate.h"
+
+#define SLOT(Seq) ((Seq) % SENSOR_AGGREGATE_MAX_WINDOW)
+
+static void aggregate_add(sensor_aggregate_t *aggregate, int32_t value) {
+    if (!aggregate->count) {
+        aggregate->shift = value;
+        aggregate->min = value;
+        aggregate->max = value;
+    } else if (value < aggregate->min) {
+        aggregate->min = value;
+    } else if (value > aggregate->max) {
+        aggregate->max = value;
+    }
+    const int64_t diff = (int64_t) value - aggregate->shift;
+    aggregate->count++;
+    aggregate->sum += diff;
+    aggregate->sum_sq += diff * diff;
+}
+
+static void aggregate_remove(sensor_aggregate_t *aggregate, int32_t value) {
+    const int64_t diff = (int64_t) value - aggregate->shift;
+    aggregate->count--;
+    aggregate->sum -= diff;
+    aggregate->sum_sq -= diff * diff;
+}
+
+sensor_aggregate_result_t
+sensor_aggregate_get(const sensor_aggregate_t *aggregate) {
+    assert(aggregate);
+
+    sensor_aggregate_result_t result = { 0 };
+    if (!aggregate->count) {
+        return result;
+    }
+    const int64_t count = aggregate->count;
+    result.count = aggregate->count;
+    result.min = aggregate->min;
+    result.max = aggregate->max;
+    result.mean = aggregate->shift + (double) aggregate->sum / (double) count;
+
+    // sum_sq - sum^2 / count, with sum = q * count + r, is
+    // sum_sq - q * sum - q * r - r^2 / count; the integer part is exact and
+    // cannot overflow, as sum^2 <= count * sum_sq. Computing it in floating
+    // point instead loses all precision once the samples drift far from the
+    // shift, which the sliding window never moves.
+    const int64_t q = aggregate->sum / count;
+    const int64_t r = aggregate->sum % count;
+    const int64_t m2 = aggregate->sum_sq - q * aggregate->sum - q * r;
+    result.variance = ((double) m2 - (double) r * (double) r / (double) count)
+                      / (double) count;
+    if (result.variance < 0.0) {
+        result.variance = 0.0;
+    }
+    return result;
+}
+
+void sensor_sliding_window_reset(sensor_sliding_window_t *window,
+                                 uint32_t size) {
+    assert(window);
+    memset(window, 0, sizeof(*window));
+    if (size < 1) {
+        size = 1;
+    } else if (size > SENSOR_AGGREGATE_MAX_WINDOW) {
+        size = SENSOR_AGGREGATE_MAX_WINDOW;
+    }
+    window->size = size;
+}
+
+static void queue_push(sensor_sliding_window_t *window,
+                       uint32_t *queue,
+                       uint32_t first,
+                       uint32_t *len,
+                       uint32_t seq,
+                       bool is_min) {
+    const int32_t value = window->values[SLOT(seq)];
+    // drop the candidates that can no longer be the extreme, as the new value
+    // is at least as good and stays in the window longer
+    while (*len) {
+        const int32_t back =
+                window->values[SLOT(queue[SLOT(first + *len - 1)])];
+        if (is_min ? back < value : back > value) {
+            break;
+        }
+        --*len;
+    }
+    queue[SLOT(first + (*len)++)] = seq;
+}
+
+void sensor_sliding_window_add(sensor_sliding_window_t *window,
+                               int32_t value) {
+    assert(window);
+
+    const uint32_t seq = window->next_seq++;
+    if (window->sums.count == window->size) {
+        const uint32_t expired_seq = seq - window->size;
+        aggregate_remove(&window->sums, window->values[SLOT(expired_seq)]);
+
+        if (window->min_len
+                && window->min_queue[window->min_first] == expired_seq) {
+            window->min_first = SLOT(window->min_first + 1);
+            window->min_len--;
+        }
+        if (window->max_len
+                && window->max_queue[window->max_first] == expired_seq) {
+            window->max_first = SLOT(window->max_first + 1);
+            window->max_len--;
+        }
+    }
+
+    window->values[SLOT(seq)] = value;
+    aggregate_add(&window->sums, value);
+    queue_push(window, window->min_queue, window->min_first, &window->min_len,
+               seq, true);
+    queue_push(window, window->max_queue, window->max_first, &window->max_len,
+               seq, false);
+}
+
+sensor_aggregate_result_t
+sensor_sliding_window_get(const sensor_sliding_window_t *window) {
+    assert(window);
+
+    sensor_aggregate_result_t result = sensor_aggregate_get(&window->sums);
+    if (result.count) {
+        result.min = window->values[SLOT(window->min_queue[window->min_first])];
+        result.max = window->values[SLOT(window->max_queue[window->max_first])];
+    }
+    return result;
+}
+
+void sensor_tumbling_window_reset(sensor_tumbling_window_t *window,
+                                  uint64_t length_us) {
+    assert(window);
+    memset(window, 0, sizeof(*window));
+    window->length_us = length_us;
+}
+
+bool sensor_tumbling_window_add(sensor_tumbling_window_t *window,
+                                uint64_t now_us,
+                                int32_t value) {
+    assert(window);
+
+    bool completed = false;
+    if (window->current.count
+            && now_us - window->start_us >= window->length_us) {
+        window->last = window->current;
+        memset(&window->current, 0, sizeof(window->current));
+        completed = true;
+    }
+    if (!window->current.count) {
+        window->start_us = now_us;
+    }
+    aggregate_add(&window->current, value);
+    return completed;
+}
+
+sensor_aggregate_result_t
+sensor_tumbling_window_get(const sensor_tumbling_window_t *window) {
+    assert(window);
+    return sensor_aggregate_get(&window->last);
+}
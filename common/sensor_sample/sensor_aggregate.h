@@ -0,0 +1,124 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Running statistics of a stream of fixed-point samples (see sensor_sample.h),
+ * updated in O(1) per sample using integer arithmetic only:
+ * - a sliding window over the last N samples, with monotonic queues for the
+ *   minimum and maximum,
+ * - a tumbling window over consecutive time intervals.
+ *
+ * Sums of differences from the first sample are kept exactly, so there is no
+ * rounding drift; the mean and variance are only computed in floating point
+ * when the result is requested. The sum of squares must fit in 64 bits: for
+ * millidegrees within 100 degrees of the first sample, that is over 900
+ * million samples per window.
+ */
+
+/* Maximum length of a sliding window, in samples */
+#ifndef SENSOR_AGGREGATE_MAX_WINDOW
+#    define SENSOR_AGGREGATE_MAX_WINDOW 32
+#endif
+
+typedef struct {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    /* in the fixed-point unit of the samples */
+    double mean;
+    /* population variance, in the square of the fixed-point unit */
+    double variance;
+} sensor_aggregate_result_t;
+
+typedef struct {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    /* value the sums are relative to */
+    int32_t shift;
+    int64_t sum;
+    int64_t sum_sq;
+} sensor_aggregate_t;
+
+/**
+ * Returns the statistics of the accumulated samples; count is 0 if there are
+ * none.
+ */
+sensor_aggregate_result_t
+sensor_aggregate_get(const sensor_aggregate_t *aggregate);
+
+typedef struct {
+    /* window length in samples, 1 to SENSOR_AGGREGATE_MAX_WINDOW */
+    uint32_t size;
+    /* values indexed by sequence number modulo SENSOR_AGGREGATE_MAX_WINDOW */
+    int32_t values[SENSOR_AGGREGATE_MAX_WINDOW];
+    /* sequence number of the next sample */
+    uint32_t next_seq;
+    /* min and max are not maintained here, see the queues below */
+    sensor_aggregate_t sums;
+    /* sequence numbers of the candidates for the minimum (increasing values)
+     * and maximum (decreasing values), oldest first */
+    uint32_t min_queue[SENSOR_AGGREGATE_MAX_WINDOW];
+    uint32_t min_first;
+    uint32_t min_len;
+    uint32_t max_queue[SENSOR_AGGREGATE_MAX_WINDOW];
+    uint32_t max_first;
+    uint32_t max_len;
+} sensor_sliding_window_t;
+
+/**
+ * Empties the window and sets its length, which is clamped to the supported
+ * range.
+ */
+void sensor_sliding_window_reset(sensor_sliding_window_t *window,
+                                 uint32_t size);
+
+void sensor_sliding_window_add(sensor_sliding_window_t *window, int32_t value);
+
+sensor_aggregate_result_t
+sensor_sliding_window_get(const sensor_sliding_window_t *window);
+
+typedef struct {
+    uint64_t length_us;
+    /* start of the current interval, valid if current.count > 0 */
+    uint64_t start_us;
+    sensor_aggregate_t current;
+    /* the last completed interval */
+    sensor_aggregate_t last;
+} sensor_tumbling_window_t;
+
+void sensor_tumbling_window_reset(sensor_tumbling_window_t *window,
+                                  uint64_t length_us);
+
+/**
+ * Adds a sample taken at now_us. If it falls outside the current interval,
+ * the interval is completed first and true is returned. Intervals are only
+ * completed when a sample arrives.
+ */
+bool sensor_tumbling_window_add(sensor_tumbling_window_t *window,
+                                uint64_t now_us,
+                                int32_t value);
+
+/**
+ * Returns the statistics of the last completed interval.
+ */
+sensor_aggregate_result_t
+sensor_tumbling_window_get(const sensor_tumbling_window_t *window);
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <anjay/anjay.h>
+
+#include "sensor_change_filter.h"
+
+void sensor_change_filter_init(sensor_change_filter_t *filter,
+                               int32_t deadband) {
+    assert(filter);
+    memset(filter, 0, sizeof(*filter));
+    filter->deadband = deadband;
+}
+
+bool sensor_change_filter_check(sensor_change_filter_t *filter,
+                                bool observed,
+                                int32_t value) {
+    assert(filter);
+
+    bool pass = !filter->has_reference || value < filter->min_value
+                || value > filter->max_value;
+    if (!pass && observed) {
+        pass = llabs((int64_t) value - filter->reference) >= filter->deadband;
+    }
+    if (!pass) {
+        return false;
+    }
+
+    if (!filter->has_reference) {
+        filter->min_value = value;
+        filter->max_value = value;
+        filter->has_reference = true;
+    } else if (value < filter->min_value) {
+        filter->min_value = value;
+    } else if (value > filter->max_value) {
+        filter->max_value = value;
+    }
+    filter->reference = value;
+    return true;
+}
+
+bool sensor_change_filter_check_resource(sensor_change_filter_t *filter,
+                                         anjay_t *anjay,
+                                         anjay_oid_t oid,
+                                         anjay_iid_t iid,
+                                         anjay_rid_t rid,
+                                         int32_t value) {
+#ifdef ANJAY_WITH_OBSERVATION_STATUS
+    const bool observed =
+            anjay_resource_observation_status(anjay, oid, iid, rid).is_observed;
+#else  // ANJAY_WITH_OBSERVATION_STATUS
+    (void) anjay;
+    (void) oid;
+    (void) iid;
+    (void) rid;
+    const bool observed = true;
+#endif // ANJAY_WITH_OBSERVATION_STATUS
+    return sensor_change_filter_check(filter, observed, value);
+}
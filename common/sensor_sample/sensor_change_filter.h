@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <anjay/core.h>
+
+/**
+ * Decides whether a new sensor sample is worth passing to Anjay (e.g. with
+ * anjay_ipso_basic_sensor_update()), which evaluates observation attributes
+ * and possibly sends a notification each time it is called.
+ *
+ * A sample is passed on if:
+ * - it is the first one,
+ * - it is outside the range of values passed so far, so that the Min/Max
+ *   Measured Value resources stay exact,
+ * - or the resource is observed and the sample differs from the last value
+ *   passed on by at least the deadband.
+ *
+ * Anjay does not expose the effective gt/lt/st attributes, so the deadband
+ * acts as the lower bound for them: it should be set to the noise level of the
+ * sensor, which is below any useful Step or threshold hysteresis. Changes
+ * smaller than the deadband are not lost for Read and pmax notifications, as
+ * these read the latest sample directly.
+ */
+
+typedef struct {
+    int32_t deadband;
+    bool has_reference;
+    /* last value passed on */
+    int32_t reference;
+    /* range of the values passed on */
+    int32_t min_value;
+    int32_t max_value;
+} sensor_change_filter_t;
+
+/**
+ * Initializes the filter. The deadband is in the fixed-point unit of the
+ * samples, see sensor_sample.h.
+ */
+void sensor_change_filter_init(sensor_change_filter_t *filter,
+                               int32_t deadband);
+
+/**
+ * Returns true if the sample should be passed on, and records it as the new
+ * reference in that case. observed tells whether the resource is observed by
+ * any server.
+ */
+bool sensor_change_filter_check(sensor_change_filter_t *filter,
+                                bool observed,
+                                int32_t value);
+
+/**
+ * Checks if the given resource is observed by any server, then calls
+ * sensor_change_filter_check().
+ */
+bool sensor_change_filter_check_resource(sensor_change_filter_t *filter,
+                                         anjay_t *anjay,
+                                         anjay_oid_t oid,
+                                         anjay_iid_t iid,
+                                         anjay_rid_t rid,
+                                         int32_t value);
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "sensor_filter.h"
+
+static uint32_t average(const uint16_t *samples, size_t count) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return (uint32_t) (((sum << SENSOR_FILTER_FRACTION_BITS) + count / 2)
+                       / count);
+}
+
+static void swap(uint16_t *a, uint16_t *b) {
+    const uint16_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**
+ * Partially sorts the samples so that samples[k] is the k-th smallest one
+ * and all before it are not greater (Hoare's selection), in O(count) on
+ * average without any extra memory.
+ */
+static void select_kth(uint16_t *samples, size_t count, size_t k) {
+    size_t left = 0;
+    size_t right = count - 1;
+    while (left < right) {
+        swap(&samples[(left + right) / 2], &samples[right]);
+        const uint16_t pivot = samples[right];
+        size_t store = left;
+        for (size_t i = left; i < right; i++) {
+            if (samples[i] < pivot) {
+                swap(&samples[i], &samples[store++]);
+            }
+        }
+        swap(&samples[store], &samples[right]);
+
+        if (store == k) {
+            return;
+        } else if (store < k) {
+            left = store + 1;
+        } else {
+            right = store - 1;
+        }
+    }
+}
+
+static uint32_t median(uint16_t *samples, size_t count) {
+    const size_t k = count / 2;
+    select_kth(samples, count, k);
+    uint32_t result = (uint32_t) samples[k] << SENSOR_FILTER_FRACTION_BITS;
+    if (count % 2 == 0) {
+        // mean of the two middle samples; the lower one is the largest of
+        // those before samples[k]
+        uint16_t lower = samples[0];
+        for (size_t i = 1; i < k; i++) {
+            if (samples[i] > lower) {
+                lower = samples[i];
+            }
+        }
+        result = (result + ((uint32_t) lower << SENSOR_FILTER_FRACTION_BITS)
+                  + 1)
+                 / 2;
+    }
+    return result;
+}
+
+uint32_t sensor_filter_apply(sensor_filter_type_t type,
+                             uint16_t *samples,
+                             size_t count) {
+    assert(samples);
+    assert(count > 0);
+
+    switch (type) {
+    case SENSOR_FILTER_MEDIAN:
+        return median(samples, count);
+    case SENSOR_FILTER_AVERAGE:
+    default:
+        return average(samples, count);
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decimation filters that reduce a block of oversampled raw readings (e.g.
+ * from an ADC) to a single value. They have no hardware dependencies, so they
+ * can be fed with recorded traces in the host build.
+ *
+ * Averaging N samples of uncorrelated noise improves the resolution by
+ * log4(N) bits, so the result carries SENSOR_FILTER_FRACTION_BITS fractional
+ * bits to keep them. The median rejects spikes instead.
+ */
+
+typedef enum {
+    SENSOR_FILTER_AVERAGE,
+    SENSOR_FILTER_MEDIAN
+} sensor_filter_type_t;
+
+/* Fractional bits of the filtered value, enough for up to 256 samples */
+#define SENSOR_FILTER_FRACTION_BITS 4
+
+/**
+ * Returns the filtered value of count (at least 1) raw samples, in raw units
+ * shifted left by SENSOR_FILTER_FRACTION_BITS and rounded to nearest. The
+ * median filter reorders the samples.
+ */
+uint32_t sensor_filter_apply(sensor_filter_type_t type,
+                             uint16_t *samples,
+                             size_t count);
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include "pico/stdlib.h"
+
+#include <avsystem/commons/avs_defs.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_time.h>
+
+#include "sensor_flash_log.h"
+
+/* Every sector is divided into 16-byte slots; the first two hold the header */
+#define SLOT_SIZE 16
+#define SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / SLOT_SIZE)
+#define SLOTS_PER_PAGE (FLASH_PAGE_SIZE / SLOT_SIZE)
+#define HEADER_SLOTS 2
+#define FIRST_RECORD_SLOT HEADER_SLOTS
+
+#define SECTOR_MAGIC 0x324F4C53 // "SLO2"
+
+/* Erased flash reads as 0xFF, and programming can only clear bits */
+#define ERASED_BYTE 0xFF
+#define STATE_UNSENT 0xFF
+#define STATE_SENT 0x00
+
+/* Maximum time to wait for the other core to stop executing from flash */
+#define FLASH_SAFE_EXECUTE_TIMEOUT_MS 100
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t erase_count;
+    /* boot in which the records of the sector have been written, and the real
+     * time at its power-up, which their timestamps are relative to */
+    uint16_t boot;
+    uint8_t reserved[2];
+    int64_t boot_time_ms;
+    uint8_t reserved_end[7];
+    uint8_t check;
+} sector_header_t;
+
+typedef struct {
+    /* time since boot_time_ms of the sector */
+    uint32_t offset_s;
+    int32_t value;
+    uint16_t offset_ms;
+    uint16_t oid;
+    uint16_t iid;
+    /* covers the fields above */
+    uint8_t check;
+    /* cleared once the record has been sent */
+    uint8_t state;
+} record_slot_t;
+
+AVS_STATIC_ASSERT(sizeof(sector_header_t) == HEADER_SLOTS * SLOT_SIZE,
+                  header_size);
+AVS_STATIC_ASSERT(sizeof(record_slot_t) == SLOT_SIZE, record_size);
+AVS_STATIC_ASSERT(offsetof(record_slot_t, check) == SLOT_SIZE - 2,
+                  record_check_offset);
+
+typedef struct {
+    uint32_t flash_offs;
+    const uint8_t *data;
+} flash_op_t;
+
+/* Page image for programming, erased outside of the bytes being written */
+static uint8_t page_buf[FLASH_PAGE_SIZE];
+
+/* CRC-8 with polynomial x^8 + x^2 + x + 1, computed bitwise as it only ever
+ * covers a few bytes */
+static uint8_t crc8(const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (uint8_t) ((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool is_erased(const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    for (size_t i = 0; i < len; i++) {
+        if (bytes[i] != ERASED_BYTE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t slot_offset(const sensor_flash_log_t *log,
+                            size_t sector,
+                            size_t slot) {
+    return log->flash_offset + (uint32_t) (sector * FLASH_SECTOR_SIZE
+                                           + slot * SLOT_SIZE);
+}
+
+static void read_slot(const sensor_flash_log_t *log,
+                      size_t sector,
+                      size_t slot,
+                      void *out) {
+    // the flash is memory-mapped, and the SDK flushes the XIP cache after
+    // every erase and program
+    memcpy(out, (const void *) (XIP_BASE + slot_offset(log, sector, slot)),
+           SLOT_SIZE);
+}
+
+static void erase_fn(void *op) {
+    flash_range_erase(((const flash_op_t *) op)->flash_offs, FLASH_SECTOR_SIZE);
+}
+
+static void program_fn(void *op) {
+    const flash_op_t *program = (const flash_op_t *) op;
+    flash_range_program(program->flash_offs, program->data, FLASH_PAGE_SIZE);
+}
+
+static int erase_sector(const sensor_flash_log_t *log, size_t sector) {
+    flash_op_t op = {
+        .flash_offs = slot_offset(log, sector, 0)
+    };
+    return flash_safe_execute(erase_fn, &op, FLASH_SAFE_EXECUTE_TIMEOUT_MS)
+                   ? -1
+                   : 0;
+}
+
+/* Programs page_buf to the page containing the given slot */
+static int program_page(const sensor_flash_log_t *log,
+                        size_t sector,
+                        size_t slot) {
+    flash_op_t op = {
+        .flash_offs = slot_offset(log, sector,
+                                  slot - slot % SLOTS_PER_PAGE),
+        .data = page_buf
+    };
+    return flash_safe_execute(program_fn, &op, FLASH_SAFE_EXECUTE_TIMEOUT_MS)
+                   ? -1
+                   : 0;
+}
+
+/* Programs size bytes, within a single page, starting at the given slot */
+static int program_slots(const sensor_flash_log_t *log,
+                         size_t sector,
+                         size_t slot,
+                         const void *data,
+                         size_t size) {
+    // the rest of the page stays as it is, since programming 0xFF
+    // leaves the bits untouched
+    memset(page_buf, ERASED_BYTE, sizeof(page_buf));
+    memcpy(&page_buf[(slot % SLOTS_PER_PAGE) * SLOT_SIZE], data, size);
+    return program_page(log, sector, slot);
+}
+
+static bool read_header(const sensor_flash_log_t *log,
+                        size_t sector,
+                        sector_header_t *out_header) {
+    memcpy(out_header,
+           (const void *) (XIP_BASE + slot_offset(log, sector, 0)),
+           sizeof(*out_header));
+    return out_header->magic == SECTOR_MAGIC
+           && out_header->check
+                      == crc8(out_header, offsetof(sector_header_t, check));
+}
+
+/* Returns true if the slot holds an intact record that has not been sent */
+static bool read_unsent_record(const sensor_flash_log_t *log,
+                               size_t sector,
+                               size_t slot,
+                               record_slot_t *out_record) {
+    read_slot(log, sector, slot, out_record);
+    return out_record->state == STATE_UNSENT
+           && !is_erased(out_record, SLOT_SIZE)
+           && out_record->check
+                      == crc8(out_record, offsetof(record_slot_t, check));
+}
+
+static void advance(const sensor_flash_log_t *log,
+                    size_t *sector,
+                    size_t *slot) {
+    if (++*slot >= SLOTS_PER_SECTOR) {
+        *sector = (*sector + 1) % log->sector_count;
+        *slot = FIRST_RECORD_SLOT;
+    }
+}
+
+static bool is_head(const sensor_flash_log_t *log, size_t sector, size_t slot) {
+    return sector == log->head_sector && slot >= log->head_slot;
+}
+
+static int start_sector(sensor_flash_log_t *log,
+                        size_t sector,
+                        uint32_t sequence) {
+    sector_header_t header;
+    const uint32_t erase_count =
+            read_header(log, sector, &header) ? header.erase_count : 0;
+    if (erase_sector(log, sector)) {
+        return -1;
+    }
+    log->stats.sector_erases++;
+
+    header = (sector_header_t) {
+        .magic = SECTOR_MAGIC,
+        .sequence = sequence,
+        .erase_count = erase_count + 1,
+        .boot = log->boot,
+        .boot_time_ms = log->boot_time_ms
+    };
+    memset(header.reserved, ERASED_BYTE, sizeof(header.reserved));
+    memset(header.reserved_end, ERASED_BYTE, sizeof(header.reserved_end));
+    header.check = crc8(&header, offsetof(sector_header_t, check));
+    if (program_slots(log, sector, 0, &header, sizeof(header))) {
+        return -1;
+    }
+
+    log->head_sector = sector;
+    log->head_slot = FIRST_RECORD_SLOT;
+    log->head_sequence = sequence;
+    log->head_boot = log->boot;
+    return 0;
+}
+
+/* Rebuilds the head, tail and pending count from the flash contents */
+static void recover(sensor_flash_log_t *log) {
+    // records are appended in order, so the head is the first erased slot of
+    // the newest sector
+    log->head_slot = FIRST_RECORD_SLOT;
+    while (log->head_slot < SLOTS_PER_SECTOR) {
+        record_slot_t record;
+        read_slot(log, log->head_sector, log->head_slot, &record);
+        if (is_erased(&record, SLOT_SIZE)) {
+            break;
+        }
+        log->head_slot++;
+    }
+
+    // sectors preceding the newest one in the ring are part of the log as
+    // long as their sequence numbers follow
+    size_t oldest = log->head_sector;
+    for (size_t distance = 1; distance < log->sector_count; distance++) {
+        const size_t sector =
+                (log->head_sector + log->sector_count - distance)
+                % log->sector_count;
+        sector_header_t header;
+        if (!read_header(log, sector, &header)
+                || header.sequence != log->head_sequence - distance) {
+            break;
+        }
+        oldest = sector;
+    }
+
+    log->pending = 0;
+    size_t sector = oldest;
+    size_t slot = FIRST_RECORD_SLOT;
+    for (; !is_head(log, sector, slot); advance(log, &sector, &slot)) {
+        record_slot_t record;
+        if (read_unsent_record(log, sector, slot, &record)) {
+            if (!log->pending++) {
+                log->tail_sector = sector;
+                log->tail_slot = slot;
+            }
+        } else if (record.state == STATE_UNSENT
+                   && !is_erased(&record, SLOT_SIZE)) {
+            log->stats.records_corrupted++;
+        }
+    }
+    if (!log->pending) {
+        log->tail_sector = log->head_sector;
+        log->tail_slot = log->head_slot;
+    }
+}
+
+int sensor_flash_log_open(sensor_flash_log_t *log,
+                          uint32_t flash_offset,
+                          size_t size) {
+    assert(log);
+    assert(flash_offset % FLASH_SECTOR_SIZE == 0);
+    assert(size % FLASH_SECTOR_SIZE == 0);
+    assert(size / FLASH_SECTOR_SIZE >= 2);
+
+    *log = (sensor_flash_log_t) {
+        .flash_offset = flash_offset,
+        .sector_count = size / FLASH_SECTOR_SIZE
+    };
+    int64_t real_now_ms;
+    if (avs_time_real_to_scalar(&real_now_ms, AVS_TIME_MS,
+                                avs_time_real_now())) {
+        return -1;
+    }
+    log->boot_time_ms = real_now_ms - (int64_t) (time_us_64() / 1000);
+
+    bool found = false;
+    for (size_t sector = 0; sector < log->sector_count; sector++) {
+        sector_header_t header;
+        if (read_header(log, sector, &header)
+                && (!found
+                    || (int32_t) (header.sequence - log->head_sequence) > 0)) {
+            found = true;
+            log->head_sector = sector;
+            log->head_sequence = header.sequence;
+            log->head_boot = header.boot;
+        }
+    }
+    // the newest sector has been written in the previous boot, at the latest
+    log->boot = found ? (uint16_t) (log->head_boot + 1) : 0;
+
+    if (!found) {
+        avs_log(sensor_flash_log, INFO, "Formatting the log at 0x%08lx",
+                (unsigned long) flash_offset);
+        if (start_sector(log, 0, 0)) {
+            return -1;
+        }
+        log->tail_sector = log->head_sector;
+        log->tail_slot = log->head_slot;
+        return 0;
+    }
+
+    recover(log);
+    avs_log(sensor_flash_log, INFO, "Recovered %lu unsent samples",
+            (unsigned long) log->pending);
+    return 0;
+}
+
+/* Moves the head to the next sector, dropping the unsent records in it */
+static int next_sector(sensor_flash_log_t *log) {
+    const size_t sector = (log->head_sector + 1) % log->sector_count;
+
+    if (log->pending && log->tail_sector == sector) {
+        size_t dropped = 0;
+        for (size_t slot = log->tail_slot; slot < SLOTS_PER_SECTOR; slot++) {
+            record_slot_t record;
+            if (read_unsent_record(log, sector, slot, &record)) {
+                dropped++;
+            }
+        }
+        log->pending -= dropped;
+        log->stats.records_dropped += (uint32_t) dropped;
+        log->drops++;
+        // the sector after it is the oldest one now
+        log->tail_sector = (sector + 1) % log->sector_count;
+        log->tail_slot = FIRST_RECORD_SLOT;
+        avs_log(sensor_flash_log, WARNING, "Log full, dropped %lu samples",
+                (unsigned long) dropped);
+    }
+
+    return start_sector(log, sector, log->head_sequence + 1);
+}
+
+int sensor_flash_log_append(sensor_flash_log_t *log,
+                            const sensor_flash_log_record_t *record) {
+    assert(log);
+    assert(record);
+
+    // every sector only holds records of a single boot, as their timestamps
+    // are relative to its power-up
+    if ((log->head_slot >= SLOTS_PER_SECTOR || log->head_boot != log->boot)
+            && next_sector(log)) {
+        return -1;
+    }
+
+    const int64_t offset_ms = record->timestamp_ms > log->boot_time_ms
+                                      ? record->timestamp_ms - log->boot_time_ms
+                                      : 0;
+    record_slot_t slot = {
+        .offset_s = (uint32_t) (offset_ms / 1000),
+        .value = record->value,
+        .offset_ms = (uint16_t) (offset_ms % 1000),
+        .oid = record->oid,
+        .iid = record->iid,
+        .state = STATE_UNSENT
+    };
+    slot.check = crc8(&slot, offsetof(record_slot_t, check));
+    if (program_slots(log, log->head_sector, log->head_slot, &slot,
+                      sizeof(slot))) {
+        return -1;
+    }
+
+    if (!log->pending) {
+        log->tail_sector = log->head_sector;
+        log->tail_slot = log->head_slot;
+    }
+    log->head_slot++;
+    log->pending++;
+    log->stats.records_written++;
+    return 0;
+}
+
+size_t sensor_flash_log_pending(const sensor_flash_log_t *log) {
+    assert(log);
+    return log->pending;
+}
+
+void sensor_flash_log_begin(const sensor_flash_log_t *log,
+                            sensor_flash_log_cursor_t *cursor) {
+    assert(log);
+    assert(cursor);
+    *cursor = (sensor_flash_log_cursor_t) {
+        .sector = log->tail_sector,
+        .slot = log->tail_slot,
+        .drops = log->drops
+    };
+}
+
+int sensor_flash_log_next(const sensor_flash_log_t *log,
+                          sensor_flash_log_cursor_t *cursor,
+                          sensor_flash_log_record_t *out_record) {
+    assert(log);
+    assert(cursor);
+    assert(out_record);
+
+    if (cursor->drops != log->drops) {
+        return -1;
+    }
+    for (; !is_head(log, cursor->sector, cursor->slot);
+         advance(log, &cursor->sector, &cursor->slot)) {
+        record_slot_t record;
+        sector_header_t header;
+        if (read_unsent_record(log, cursor->sector, cursor->slot, &record)
+                && read_header(log, cursor->sector, &header)) {
+            // records of previous boots are rebased on the time of their own
+            // power-up
+            *out_record = (sensor_flash_log_record_t) {
+                .timestamp_ms = header.boot_time_ms
+                                + (int64_t) record.offset_s * 1000
+                                + record.offset_ms,
+                .value = record.value,
+                .oid = record.oid,
+                .iid = record.iid
+            };
+            advance(log, &cursor->sector, &cursor->slot);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int sensor_flash_log_mark_sent(sensor_flash_log_t *log,
+                               const sensor_flash_log_cursor_t *cursor) {
+    assert(log);
+    assert(cursor);
+
+    if (cursor->drops != log->drops) {
+        return -1;
+    }
+
+    // all unsent records in a page are marked with a single program
+    size_t sector = log->tail_sector;
+    size_t slot = log->tail_slot;
+    while (log->pending
+           && !(sector == cursor->sector && slot >= cursor->slot)
+           && !is_head(log, sector, slot)) {
+        const size_t page_sector = sector;
+        const size_t page_end = slot - slot % SLOTS_PER_PAGE + SLOTS_PER_PAGE;
+        size_t in_page = 0;
+        memset(page_buf, ERASED_BYTE, sizeof(page_buf));
+        for (; sector == page_sector && slot < page_end
+               && !(sector == cursor->sector && slot >= cursor->slot)
+               && !is_head(log, sector, slot);
+             advance(log, &sector, &slot)) {
+            record_slot_t record;
+            if (read_unsent_record(log, sector, slot, &record)) {
+                page_buf[(slot % SLOTS_PER_PAGE) * SLOT_SIZE
+                         + offsetof(record_slot_t, state)] = STATE_SENT;
+                in_page++;
+            }
+        }
+        if (in_page && program_page(log, page_sector, page_end - 1)) {
+            return -1;
+        }
+        log->pending -= in_page;
+        log->stats.records_sent += (uint32_t) in_page;
+        log->tail_sector = sector;
+        log->tail_slot = slot;
+    }
+
+    if (!log->pending) {
+        log->tail_sector = log->head_sector;
+        log->tail_slot = log->head_slot;
+    }
+    return 0;
+}
+
+void sensor_flash_log_get_stats(const sensor_flash_log_t *log,
+                                sensor_flash_log_stats_t *out_stats) {
+    assert(log);
+    assert(out_stats);
+
+    *out_stats = log->stats;
+    out_stats->min_erase_count = UINT32_MAX;
+    out_stats->max_erase_count = 0;
+    for (size_t sector = 0; sector < log->sector_count; sector++) {
+        sector_header_t header;
+        const uint32_t erase_count =
+                read_header(log, sector, &header) ? header.erase_count : 0;
+        if (erase_count < out_stats->min_erase_count) {
+            out_stats->min_erase_count = erase_count;
+        }
+        if (erase_count > out_stats->max_erase_count) {
+            out_stats->max_erase_count = erase_count;
+        }
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <anjay/core.h>
+
+#include "hardware/flash.h"
+
+/**
+ * Log-structured ring of timestamped samples in a dedicated flash region,
+ * which keeps samples that could not be sent across connectivity loss and
+ * reboots. See common/sensor_sample/README.md for an overview.
+ *
+ * The region is divided into erase sectors, each starting with a header that
+ * holds a sequence number, the number of times the sector has been erased,
+ * the number of the boot its records belong to and the real time at the
+ * power-up of that boot. Records are appended to the newest sector. When it
+ * is full, the next sector in the ring is erased, dropping any samples it
+ * still holds, so all sectors are erased equally often. Sent records are
+ * marked in place by clearing their state byte, which needs no erase. The
+ * state is rebuilt from the headers and records when the log is opened.
+ *
+ * Records store their time relative to the power-up of their boot, and are
+ * read back rebased on the power-up time of that boot, so samples of
+ * previous boots are kept and drained like the others. Opening the log starts
+ * a new boot, whose first record goes to a new sector; the log must therefore
+ * be opened once per boot.
+ *
+ * A record is written with a single page program, so a power loss can only
+ * tear the record being written. Such records fail the check and are skipped.
+ *
+ * In the host build, the flash stand-in keeps the region in a file (see
+ * hardware/flash.h) and measures wear and throughput.
+ *
+ * All functions must be called from the same task.
+ */
+
+/* Default region: the last 64 KiB of the flash */
+#ifndef SENSOR_FLASH_LOG_SIZE
+#    define SENSOR_FLASH_LOG_SIZE (64 * 1024)
+#endif
+#ifndef SENSOR_FLASH_LOG_OFFSET
+#    define SENSOR_FLASH_LOG_OFFSET \
+        (PICO_FLASH_SIZE_BYTES - SENSOR_FLASH_LOG_SIZE)
+#endif
+
+typedef struct {
+    /* real time, in milliseconds since the Unix epoch */
+    int64_t timestamp_ms;
+    /* fixed-point value, see sensor_sample.h */
+    int32_t value;
+    anjay_oid_t oid;
+    anjay_iid_t iid;
+} sensor_flash_log_record_t;
+
+typedef struct {
+    /* Number of records appended and marked as sent since the log was opened
+     */
+    uint32_t records_written;
+    uint32_t records_sent;
+    /* Number of unsent records dropped by erasing the sector holding them */
+    uint32_t records_dropped;
+    /* Number of records skipped because they failed the check */
+    uint32_t records_corrupted;
+    uint32_t sector_erases;
+    /* Lowest and highest erase count of any sector in the region */
+    uint32_t min_erase_count;
+    uint32_t max_erase_count;
+} sensor_flash_log_stats_t;
+
+typedef struct {
+    size_t sector;
+    size_t slot;
+    /* drops counter of the log when the cursor was created */
+    uint32_t drops;
+} sensor_flash_log_cursor_t;
+
+typedef struct {
+    uint32_t flash_offset;
+    size_t sector_count;
+
+    /* sector and slot of the next record to write */
+    size_t head_sector;
+    size_t head_slot;
+    uint32_t head_sequence;
+    /* boot of the records in the head sector, and the current one */
+    uint16_t head_boot;
+    uint16_t boot;
+    /* real time at the power-up of the current boot, in milliseconds since
+     * the Unix epoch */
+    int64_t boot_time_ms;
+    /* oldest record that may be unsent */
+    size_t tail_sector;
+    size_t tail_slot;
+    /* number of records between tail and head that are not marked as sent */
+    size_t pending;
+    /* incremented whenever unsent records are erased, which invalidates
+     * cursors */
+    uint32_t drops;
+    sensor_flash_log_stats_t stats;
+} sensor_flash_log_t;
+
+/**
+ * Opens the log in the flash region of size bytes at flash_offset, both
+ * multiples of FLASH_SECTOR_SIZE, with at least two sectors, and starts a new
+ * boot. Recovers the records left by previous boots, or formats the region if
+ * it holds none.
+ */
+int sensor_flash_log_open(sensor_flash_log_t *log,
+                          uint32_t flash_offset,
+                          size_t size);
+
+/**
+ * Appends a record, erasing the oldest sector first if the newest one is full.
+ */
+int sensor_flash_log_append(sensor_flash_log_t *log,
+                            const sensor_flash_log_record_t *record);
+
+/**
+ * Returns the number of records that have not been marked as sent.
+ */
+size_t sensor_flash_log_pending(const sensor_flash_log_t *log);
+
+/**
+ * Starts iterating over the unsent records, oldest first.
+ */
+void sensor_flash_log_begin(const sensor_flash_log_t *log,
+                            sensor_flash_log_cursor_t *cursor);
+
+/**
+ * Reads the next unsent record and advances the cursor past it. Returns -1 if
+ * there are no more records.
+ */
+int sensor_flash_log_next(const sensor_flash_log_t *log,
+                          sensor_flash_log_cursor_t *cursor,
+                          sensor_flash_log_record_t *out_record);
+
+/**
+ * Marks all records before the cursor as sent. Returns -1 without marking
+ * anything if some of these records have been dropped since the cursor was
+ * created, as their slots may hold new records now.
+ */
+int sensor_flash_log_mark_sent(sensor_flash_log_t *log,
+                               const sensor_flash_log_cursor_t *cursor);
+
+/**
+ * Copies the counters, reading the erase counts from the sector headers.
+ */
+void sensor_flash_log_get_stats(const sensor_flash_log_t *log,
+                                sensor_flash_log_stats_t *out_stats);
@@ -0,0 +1,365 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "pico/stdlib.h"
+
+#include <anjay/anjay.h>
+#include <avsystem/commons/avs_log.h>
+#include <avsystem/commons/avs_time.h>
+
+#ifdef ANJAY_WITH_SEND
+#    include <anjay/lwm2m_send.h>
+#endif // ANJAY_WITH_SEND
+
+#include "sensor_history.h"
+#include "sensor_sample.h"
+
+void sensor_history_init(sensor_history_t *history) {
+    assert(history);
+    assert(history->anjay);
+    assert(history->entries);
+    assert(history->capacity > 0);
+
+    history->first = 0;
+    history->count = 0;
+    history->flush_job = NULL;
+    history->flush_failed = false;
+    history->sent_count = 0;
+    history->drain_job = NULL;
+    history->drain_in_flight = false;
+    history->stats = (sensor_history_stats_t) { 0 };
+}
+
+void sensor_history_cleanup(sensor_history_t *history) {
+    avs_sched_del(&history->flush_job);
+    avs_sched_del(&history->drain_job);
+    history->count = 0;
+    history->sent_count = 0;
+}
+
+static void flush_job(avs_sched_t *sched, const void *history_ptr) {
+    (void) sched;
+    sensor_history_flush(*(sensor_history_t *const *) history_ptr);
+}
+
+static void schedule_flush(sensor_history_t *history) {
+    if (history->flush_job || history->flush_interval_ms <= 0) {
+        return;
+    }
+    if (AVS_SCHED_DELAYED(anjay_get_scheduler(history->anjay),
+                          &history->flush_job,
+                          avs_time_duration_from_scalar(
+                                  history->flush_interval_ms, AVS_TIME_MS),
+                          flush_job, &history, sizeof(history))) {
+        avs_log(sensor_history, ERROR, "Could not schedule flush job");
+    }
+}
+
+void sensor_history_add(sensor_history_t *history,
+                        anjay_iid_t iid,
+                        int32_t value) {
+    sensor_history_add_at(history, iid, value, time_us_64());
+}
+
+void sensor_history_add_at(sensor_history_t *history,
+                           anjay_iid_t iid,
+                           int32_t value,
+                           uint64_t timestamp_us) {
+    sensor_history_add_object_at(history, history->oid, iid, value,
+                                 timestamp_us);
+}
+
+void sensor_history_add_object_at(sensor_history_t *history,
+                                  anjay_oid_t oid,
+                                  anjay_iid_t iid,
+                                  int32_t value,
+                                  uint64_t timestamp_us) {
+    assert(history);
+
+    size_t index;
+    if (history->count < history->capacity) {
+        index = (history->first + history->count++) % history->capacity;
+    } else {
+        // the previous flush has failed or is still awaiting confirmation,
+        // overwrite the oldest sample
+        index = history->first;
+        history->first = (history->first + 1) % history->capacity;
+        history->stats.samples_dropped++;
+        if (history->sent_count) {
+            history->sent_count--;
+        }
+    }
+    history->entries[index] = (sensor_history_entry_t) {
+        .timestamp_us = timestamp_us,
+        .value = value,
+        .oid = oid,
+        .iid = iid
+    };
+
+    if (history->count == history->capacity && !history->flush_failed
+            && !history->sent_count) {
+        sensor_history_flush(history);
+    } else {
+        schedule_flush(history);
+    }
+}
+
+#ifdef ANJAY_WITH_SEND
+/* Samples carry the monotonic clock, Send and the flash log need real time */
+static avs_time_real_t entry_real_time(const sensor_history_entry_t *entry,
+                                       uint64_t now_us,
+                                       avs_time_real_t real_now) {
+    return avs_time_real_add(real_now,
+                             avs_time_duration_from_scalar(
+                                     -(int64_t) (now_us - entry->timestamp_us),
+                                     AVS_TIME_US));
+}
+
+/* Moves all buffered samples to the flash log */
+static int store_in_log(sensor_history_t *history) {
+    assert(!history->sent_count);
+
+    const uint64_t now_us = time_us_64();
+    const avs_time_real_t real_now = avs_time_real_now();
+
+    while (history->count) {
+        const sensor_history_entry_t *entry = &history->entries[history->first];
+        sensor_flash_log_record_t record = {
+            .value = entry->value,
+            .oid = entry->oid,
+            .iid = entry->iid
+        };
+        if (avs_time_duration_to_scalar(
+                    &record.timestamp_ms, AVS_TIME_MS,
+                    entry_real_time(entry, now_us, real_now).since_real_epoch)
+                || sensor_flash_log_append(history->log, &record)) {
+            avs_log(sensor_history, ERROR,
+                    "Could not store samples in the flash log");
+            return -1;
+        }
+        history->first = (history->first + 1) % history->capacity;
+        history->count--;
+        history->stats.samples_stored++;
+    }
+    history->first = 0;
+    return 0;
+}
+
+static void schedule_drain(sensor_history_t *history);
+
+static void drain_finished(anjay_t *anjay,
+                           anjay_ssid_t ssid,
+                           const anjay_send_batch_t *batch,
+                           int result,
+                           void *history_ptr) {
+    (void) anjay;
+    (void) ssid;
+    (void) batch;
+
+    sensor_history_t *history = (sensor_history_t *) history_ptr;
+    history->drain_in_flight = false;
+    if (result != ANJAY_SEND_SUCCESS) {
+        // the samples stay in the log until the next successful send
+        avs_log(sensor_history, WARNING,
+                "Samples from the flash log were not confirmed, result: %d",
+                result);
+        return;
+    }
+
+    const size_t pending = sensor_flash_log_pending(history->log);
+    if (sensor_flash_log_mark_sent(history->log, &history->drain_cursor)) {
+        // some of the samples have been dropped in the meantime; the rest may
+        // be sent again
+        return;
+    }
+    history->stats.samples_drained +=
+            (uint32_t) (pending - sensor_flash_log_pending(history->log));
+    schedule_drain(history);
+}
+
+static void drain_job(avs_sched_t *sched, const void *history_ptr) {
+    (void) sched;
+    sensor_history_t *history = *(sensor_history_t *const *) history_ptr;
+
+    anjay_send_batch_builder_t *builder = anjay_send_batch_builder_new();
+    if (!builder) {
+        return;
+    }
+
+    sensor_flash_log_begin(history->log, &history->drain_cursor);
+    int result = 0;
+    size_t count = 0;
+    sensor_flash_log_record_t record;
+    while (!result && count < SENSOR_HISTORY_DRAIN_BATCH_SIZE
+           && !sensor_flash_log_next(history->log, &history->drain_cursor,
+                                     &record)) {
+        result = anjay_send_batch_add_double(
+                builder, record.oid, record.iid, history->rid,
+                ANJAY_ID_INVALID,
+                avs_time_real_from_scalar(record.timestamp_ms, AVS_TIME_MS),
+                sensor_sample_to_double(record.value));
+        count++;
+    }
+
+    anjay_send_batch_t *batch = NULL;
+    if (!result && count
+            && !(batch = anjay_send_batch_builder_compile(&builder))) {
+        result = -1;
+    }
+    anjay_send_batch_builder_cleanup(&builder);
+
+    if (!result && batch) {
+        if (anjay_send(history->anjay, history->ssid, batch, drain_finished,
+                       history)
+                == ANJAY_SEND_OK) {
+            history->drain_in_flight = true;
+        } else {
+            avs_log(sensor_history, WARNING,
+                    "Could not send samples from the flash log");
+        }
+    }
+    anjay_send_batch_release(&batch);
+}
+
+static void schedule_drain(sensor_history_t *history) {
+    if (!history->log || history->drain_job || history->drain_in_flight
+            || !sensor_flash_log_pending(history->log)) {
+        return;
+    }
+    if (AVS_SCHED_NOW(anjay_get_scheduler(history->anjay), &history->drain_job,
+                      drain_job, &history, sizeof(history))) {
+        avs_log(sensor_history, ERROR, "Could not schedule drain job");
+    }
+}
+
+/* Handles a failed or unconfirmed send of all samples in the buffer */
+static void handle_send_failure(sensor_history_t *history) {
+    history->stats.send_errors++;
+    // move the samples to flash if possible, otherwise keep them and try
+    // again later
+    history->flush_failed = !history->log || store_in_log(history);
+    if (history->flush_failed) {
+        schedule_flush(history);
+    }
+}
+
+static void send_finished(anjay_t *anjay,
+                          anjay_ssid_t ssid,
+                          const anjay_send_batch_t *batch,
+                          int result,
+                          void *history_ptr) {
+    (void) anjay;
+    (void) batch;
+
+    sensor_history_t *history = (sensor_history_t *) history_ptr;
+    const size_t sent_count = history->sent_count;
+    history->sent_count = 0;
+    if (result != ANJAY_SEND_SUCCESS) {
+        avs_log(sensor_history, WARNING,
+                "Send to SSID %u was not confirmed, result: %d",
+                (unsigned) ssid, result);
+        handle_send_failure(history);
+        return;
+    }
+
+    history->flush_failed = false;
+    history->stats.batches_sent++;
+    history->stats.samples_sent += (uint32_t) sent_count;
+    history->first = (history->first + sent_count) % history->capacity;
+    history->count -= sent_count;
+    if (!history->count) {
+        history->first = 0;
+    } else {
+        // samples added while the batch was in flight
+        schedule_flush(history);
+    }
+    // the server is reachable again, send what has been stored in the
+    // meantime
+    schedule_drain(history);
+}
+
+int sensor_history_flush(sensor_history_t *history) {
+    assert(history);
+
+    avs_sched_del(&history->flush_job);
+    if (!history->count || history->sent_count) {
+        // send_finished() schedules the next flush if needed
+        return 0;
+    }
+
+    anjay_send_batch_builder_t *builder = anjay_send_batch_builder_new();
+    if (!builder) {
+        return -1;
+    }
+
+    const uint64_t now_us = time_us_64();
+    const avs_time_real_t real_now = avs_time_real_now();
+
+    int result = 0;
+    for (size_t i = 0; !result && i < history->count; i++) {
+        const sensor_history_entry_t *entry =
+                &history->entries[(history->first + i) % history->capacity];
+        result = anjay_send_batch_add_double(builder, entry->oid,
+                                             entry->iid, history->rid,
+                                             ANJAY_ID_INVALID,
+                                             entry_real_time(entry, now_us,
+                                                             real_now),
+                                             sensor_sample_to_double(
+                                                     entry->value));
+    }
+
+    anjay_send_batch_t *batch = NULL;
+    if (!result && !(batch = anjay_send_batch_builder_compile(&builder))) {
+        result = -1;
+    }
+    anjay_send_batch_builder_cleanup(&builder);
+
+    if (!result) {
+        const anjay_send_result_t send_result =
+                anjay_send(history->anjay, history->ssid, batch, send_finished,
+                           history);
+        if (send_result != ANJAY_SEND_OK) {
+            avs_log(sensor_history, WARNING, "Send failed, result: %d",
+                    (int) send_result);
+            result = -1;
+        }
+    }
+    anjay_send_batch_release(&batch);
+
+    if (result) {
+        handle_send_failure(history);
+        return -1;
+    }
+
+    // the samples are removed in send_finished(), once the server confirms
+    // them
+    history->sent_count = history->count;
+    return 0;
+}
+#else  // ANJAY_WITH_SEND
+int sensor_history_flush(sensor_history_t *history) {
+    assert(history);
+
+    // nothing to send with, just make room for new samples
+    avs_sched_del(&history->flush_job);
+    history->stats.samples_dropped += (uint32_t) history->count;
+    history->first = 0;
+    history->count = 0;
+    return -1;
+}
+#endif // ANJAY_WITH_SEND
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <anjay/core.h>
+#include <avsystem/commons/avs_sched.h>
+
+#include "sensor_flash_log.h"
+
+/**
+ * RAM ring buffer of timestamped samples of the same resource in all
+ * instances of one or more objects (see sensor_history_add_object_at()),
+ * uploaded to the server with LwM2M Send. Each entry records the object and
+ * instance it belongs to. All samples collected since the previous upload go
+ * in a single batch, which Anjay encodes as SenML CBOR, so N samples cost one
+ * message instead of N notifications.
+ *
+ * The buffer is flushed when it becomes full, and flush_interval_ms after the
+ * first sample added to an empty buffer. Sent samples stay in the buffer until
+ * the server confirms them. If the server cannot be reached, the samples are
+ * kept for the next attempt and the oldest ones are overwritten once the
+ * buffer is full.
+ *
+ * If a flash log is attached, samples that could not be sent are moved to it
+ * instead, which frees the buffer and keeps them across reboots. After the
+ * next successful send, the log is drained in batches of up to
+ * SENSOR_HISTORY_DRAIN_BATCH_SIZE samples, each sent once the previous one
+ * has been confirmed, and the samples are marked as sent in flash only after
+ * their batch has been confirmed.
+ *
+ * All functions must be called from the task running the event loop.
+ */
+
+/* Maximum number of samples from the flash log sent in one message */
+#ifndef SENSOR_HISTORY_DRAIN_BATCH_SIZE
+#    define SENSOR_HISTORY_DRAIN_BATCH_SIZE 50
+#endif
+
+typedef struct {
+    /* time_us_64() at which the sample was taken */
+    uint64_t timestamp_us;
+    /* fixed-point value, see sensor_sample.h */
+    int32_t value;
+    anjay_oid_t oid;
+    anjay_iid_t iid;
+} sensor_history_entry_t;
+
+typedef struct {
+    /* Counters of batches confirmed by the server and the samples they
+     * carried */
+    uint32_t batches_sent;
+    uint32_t samples_sent;
+    /* Number of batches that could not be sent or were not confirmed */
+    uint32_t send_errors;
+    /* Number of samples overwritten before they could be sent */
+    uint32_t samples_dropped;
+    /* Number of samples moved to the flash log, and of those confirmed by the
+     * server after draining it */
+    uint32_t samples_stored;
+    uint32_t samples_drained;
+} sensor_history_stats_t;
+
+typedef struct {
+    anjay_t *anjay;
+    anjay_ssid_t ssid;
+    anjay_oid_t oid;
+    anjay_rid_t rid;
+    int32_t flush_interval_ms;
+    /* storage provided by the user */
+    sensor_history_entry_t *entries;
+    size_t capacity;
+    /* opened flash log for samples that could not be sent, or NULL */
+    sensor_flash_log_t *log;
+
+    size_t first;
+    size_t count;
+    avs_sched_handle_t flush_job;
+    /* set if the last flush failed; the retry is left to the flush job */
+    bool flush_failed;
+    /* number of samples at the start of the buffer that await confirmation
+     * of the batch they were sent in */
+    size_t sent_count;
+    avs_sched_handle_t drain_job;
+    /* set while a batch from the log awaits confirmation; the cursor points
+     * past its last sample */
+    bool drain_in_flight;
+    sensor_flash_log_cursor_t drain_cursor;
+    sensor_history_stats_t stats;
+} sensor_history_t;
+
+/**
+ * Prepares the buffer for use. The fields up to log must be set before.
+ */
+void sensor_history_init(sensor_history_t *history);
+
+void sensor_history_cleanup(sensor_history_t *history);
+
+void sensor_history_add(sensor_history_t *history,
+                        anjay_iid_t iid,
+                        int32_t value);
+
+/**
+ * Same as sensor_history_add(), for a sample taken earlier at timestamp_us
+ * (on the time_us_64() clock), e.g. read from a sensor FIFO.
+ */
+void sensor_history_add_at(sensor_history_t *history,
+                           anjay_iid_t iid,
+                           int32_t value,
+                           uint64_t timestamp_us);
+
+/**
+ * Same as sensor_history_add_at(), for the same resource of another object,
+ * e.g. another quantity measured by the same sensor. Samples of all objects
+ * are sent in the same batch.
+ */
+void sensor_history_add_object_at(sensor_history_t *history,
+                                  anjay_oid_t oid,
+                                  anjay_iid_t iid,
+                                  int32_t value,
+                                  uint64_t timestamp_us);
+
+/**
+ * Sends all buffered samples right away. Returns 0 if there was nothing to
+ * send, the batch was passed to Anjay, or the previous batch still awaits
+ * confirmation, in which case the samples are sent after it is confirmed.
+ */
+int sensor_history_flush(sensor_history_t *history);
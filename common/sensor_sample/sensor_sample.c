@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sensor_sample.h"
+
+void sensor_sample_store_init(sensor_sample_store_t *store) {
+    assert(store);
+    memset(store, 0, sizeof(*store));
+    store->sample.status = SENSOR_SAMPLE_NONE;
+}
+
+void sensor_sample_store_write(sensor_sample_store_t *store,
+                               const sensor_sample_t *sample) {
+    assert(store);
+    assert(sample);
+
+    // there is a single writer, so the sequence does not need an atomic
+    // read-modify-write, which Cortex-M0+ does not have anyway. The write is
+    // not preemptible, otherwise a higher priority reader on the same core
+    // could spin forever on an odd sequence.
+    taskENTER_CRITICAL();
+    const uint32_t sequence =
+            __atomic_load_n(&store->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&store->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    store->sample = *sample;
+    __atomic_store_n(&store->sequence, sequence + 2, __ATOMIC_RELEASE);
+    taskEXIT_CRITICAL();
+}
+
+void sensor_sample_store_put(sensor_sample_store_t *store, int32_t value) {
+    const sensor_sample_t sample = {
+        .value = value,
+        .timestamp_us = time_us_64(),
+        .status = SENSOR_SAMPLE_OK
+    };
+    sensor_sample_store_write(store, &sample);
+}
+
+void sensor_sample_store_put_error(sensor_sample_store_t *store) {
+    sensor_sample_t sample;
+    sensor_sample_store_read(store, &sample);
+    sample.timestamp_us = time_us_64();
+    sample.status = SENSOR_SAMPLE_ERROR;
+    sensor_sample_store_write(store, &sample);
+}
+
+void sensor_sample_store_read(const sensor_sample_store_t *store,
+                              sensor_sample_t *out_sample) {
+    assert(store);
+    assert(out_sample);
+
+    uint32_t begin;
+    uint32_t end;
+    do {
+        begin = __atomic_load_n(&store->sequence, __ATOMIC_ACQUIRE);
+        *out_sample = store->sample;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&store->sequence, __ATOMIC_RELAXED);
+    } while ((begin & 1) || begin != end);
+}
+
+int sensor_sample_store_get_value(const sensor_sample_store_t *store,
+                                  int32_t *out_value) {
+    assert(out_value);
+
+    sensor_sample_t sample;
+    sensor_sample_store_read(store, &sample);
+    if (sample.status != SENSOR_SAMPLE_OK) {
+        return -1;
+    }
+    *out_value = sample.value;
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Latest-sample store shared between a sensor driver and the LwM2M data
+ * model. The driver (a single producer per store) writes every new sample,
+ * while Read and Observe handlers only copy the most recent one, so they never
+ * wait for the sensor bus.
+ *
+ * The store is a sequence lock: the writer never waits for readers and
+ * readers, which never lock anything, retry if a write happened while they
+ * were copying. Readers may run in any task and on any core; there must be
+ * only one writer per store, running in a task.
+ *
+ * Values are fixed-point integers in thousandths of the sensor unit (e.g.
+ * millidegrees Celsius), as the RP2040 has no FPU and every floating-point
+ * operation is a library call. They are converted to double only where they
+ * are passed to Anjay, using sensor_sample_to_double().
+ */
+
+/* Number of fixed-point units in one unit of the sensor value */
+#define SENSOR_SAMPLE_SCALE 1000
+
+typedef enum {
+    /* No sample has been taken yet */
+    SENSOR_SAMPLE_NONE,
+    SENSOR_SAMPLE_OK,
+    /* The latest attempt to sample the sensor has failed */
+    SENSOR_SAMPLE_ERROR
+} sensor_sample_status_t;
+
+typedef struct {
+    /* in 1/SENSOR_SAMPLE_SCALE of the sensor unit */
+    int32_t value;
+    /* time_us_64() at which the sample was taken */
+    uint64_t timestamp_us;
+    sensor_sample_status_t status;
+} sensor_sample_t;
+
+typedef struct {
+    /* odd while a write is in progress */
+    uint32_t sequence;
+    sensor_sample_t sample;
+} sensor_sample_store_t;
+
+void sensor_sample_store_init(sensor_sample_store_t *store);
+
+/**
+ * Stores a successfully read value, timestamped with the current time.
+ */
+void sensor_sample_store_put(sensor_sample_store_t *store, int32_t value);
+
+/**
+ * Marks the latest sample as failed, keeping the last good value.
+ */
+void sensor_sample_store_put_error(sensor_sample_store_t *store);
+
+void sensor_sample_store_write(sensor_sample_store_t *store,
+                               const sensor_sample_t *sample);
+
+void sensor_sample_store_read(const sensor_sample_store_t *store,
+                              sensor_sample_t *out_sample);
+
+/**
+ * Returns 0 and the latest value if the most recent sample is valid, or -1
+ * otherwise.
+ */
+int sensor_sample_store_get_value(const sensor_sample_store_t *store,
+                                  int32_t *out_value);
+
+static inline double sensor_sample_to_double(int32_t value) {
+    return (double) value / SENSOR_SAMPLE_SCALE;
+}
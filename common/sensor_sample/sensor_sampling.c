@@ -0,0 +1,120 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include <anjay/anjay.h>
+#include <avsystem/commons/avs_defs.h>
+#include <avsystem/commons/avs_log.h>
+
+#include "sensor_sampling.h"
+
+static int32_t resource_period_ms(sensor_sampling_t *sampling,
+                                  anjay_oid_t oid,
+                                  anjay_iid_t iid) {
+#ifdef ANJAY_WITH_OBSERVATION_STATUS
+    const anjay_resource_observation_status_t status =
+            anjay_resource_observation_status(sampling->anjay, oid, iid,
+                                              sampling->rid);
+    if (!status.is_observed) {
+        return -1;
+    }
+
+    // sampling more often than pmin cannot produce more notifications
+    int32_t period_ms = SENSOR_SAMPLING_DEFAULT_PERIOD_MS;
+    if (status.min_period > 0
+            && status.min_period < INT32_MAX / 1000
+            && status.min_period * 1000 > period_ms) {
+        period_ms = status.min_period * 1000;
+    }
+    if (status.max_eval_period > 0
+            && status.max_eval_period < INT32_MAX / 1000
+            && status.max_eval_period * 1000 < period_ms) {
+        period_ms = status.max_eval_period * 1000;
+    }
+    return period_ms;
+#else  // ANJAY_WITH_OBSERVATION_STATUS
+    (void) sampling;
+    (void) oid;
+    (void) iid;
+    return SENSOR_SAMPLING_DEFAULT_PERIOD_MS;
+#endif // ANJAY_WITH_OBSERVATION_STATUS
+}
+
+static int32_t sampling_period_ms(sensor_sampling_t *sampling) {
+    int32_t period_ms = -1;
+    const anjay_oid_t oids[] = { sampling->oid, sampling->secondary_oid };
+    for (size_t i = 0; i < AVS_ARRAY_SIZE(oids) && (!i || oids[i]); i++) {
+        for (anjay_iid_t iid = 0; iid < sampling->instance_count; iid++) {
+            const int32_t instance_period_ms =
+                    resource_period_ms(sampling, oids[i], iid);
+            if (instance_period_ms >= 0
+                    && (period_ms < 0 || instance_period_ms < period_ms)) {
+                period_ms = instance_period_ms;
+            }
+        }
+    }
+    if (period_ms < 0) {
+        return sampling->idle_period_ms;
+    }
+    return period_ms < SENSOR_SAMPLING_MIN_PERIOD_MS
+                   ? SENSOR_SAMPLING_MIN_PERIOD_MS
+                   : period_ms;
+}
+
+static void sampling_job(avs_sched_t *sched, const void *sampling_ptr) {
+    (void) sched;
+    sensor_sampling_t *sampling = *(sensor_sampling_t *const *) sampling_ptr;
+
+    sampling->sampling_now = true;
+    int32_t delay_ms = sampling->sample(sampling->anjay);
+    sampling->sampling_now = false;
+    if (delay_ms <= 0 && !(delay_ms = sampling_period_ms(sampling))) {
+        // nobody is interested, wait for sensor_sampling_kick()
+        return;
+    }
+
+    if (AVS_SCHED_DELAYED(anjay_get_scheduler(sampling->anjay),
+                          &sampling->job,
+                          avs_time_duration_from_scalar(delay_ms, AVS_TIME_MS),
+                          sampling_job, &sampling, sizeof(sampling))) {
+        avs_log(sensor_sampling, ERROR, "Could not schedule sampling job");
+    }
+}
+
+int sensor_sampling_start(sensor_sampling_t *sampling) {
+    assert(sampling);
+    assert(sampling->anjay);
+    assert(sampling->sample);
+
+    avs_sched_del(&sampling->job);
+    if (AVS_SCHED_NOW(anjay_get_scheduler(sampling->anjay), &sampling->job,
+                      sampling_job, &sampling, sizeof(sampling))) {
+        avs_log(sensor_sampling, ERROR, "Could not schedule sampling job");
+        return -1;
+    }
+    return 0;
+}
+
+void sensor_sampling_stop(sensor_sampling_t *sampling) {
+    avs_sched_del(&sampling->job);
+}
+
+void sensor_sampling_kick(sensor_sampling_t *sampling) {
+    if (!sampling->job && !sampling->sampling_now && sampling->anjay) {
+        sensor_sampling_start(sampling);
+    }
+}
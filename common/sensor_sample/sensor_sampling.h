@@ -0,0 +1,84 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <anjay/core.h>
+#include <avsystem/commons/avs_sched.h>
+
+/**
+ * Periodic sampling of a sensor driven by a job on the Anjay scheduler, so the
+ * sensor is sampled in the task running the event loop instead of a dedicated
+ * one.
+ *
+ * The period follows the observations of the given resource in all instances
+ * of the object, and optionally of a second object with the same instances
+ * and resource (e.g. another quantity measured by the same sensor): the job
+ * runs every SENSOR_SAMPLING_DEFAULT_PERIOD_MS, or every pmin if that is
+ * longer, and never later than epmax if it is set.
+ * While the resource is not observed at all, the period is idle_period_ms; if
+ * that is 0, sampling stops until sensor_sampling_kick() is called.
+ */
+
+#ifndef SENSOR_SAMPLING_DEFAULT_PERIOD_MS
+#    define SENSOR_SAMPLING_DEFAULT_PERIOD_MS 2000
+#endif
+
+#ifndef SENSOR_SAMPLING_MIN_PERIOD_MS
+#    define SENSOR_SAMPLING_MIN_PERIOD_MS 100
+#endif
+
+/**
+ * Takes a sample. Returns 0 to wait for the regular period before the next
+ * call, or a positive number of milliseconds to be called again sooner, e.g.
+ * while a conversion is still in progress.
+ */
+typedef int32_t sensor_sampling_cb_t(anjay_t *anjay);
+
+typedef struct {
+    anjay_t *anjay;
+    anjay_oid_t oid;
+    /* checked for observations along with oid if nonzero */
+    anjay_oid_t secondary_oid;
+    /* instances 0 to instance_count - 1 are checked for observations */
+    anjay_iid_t instance_count;
+    anjay_rid_t rid;
+    int32_t idle_period_ms;
+    sensor_sampling_cb_t *sample;
+
+    avs_sched_handle_t job;
+    /* set while sample() runs, the job handle is NULL at that time */
+    bool sampling_now;
+} sensor_sampling_t;
+
+/**
+ * Takes the first sample as soon as possible and keeps sampling. The fields
+ * of sampling other than job must be set before.
+ */
+int sensor_sampling_start(sensor_sampling_t *sampling);
+
+void sensor_sampling_stop(sensor_sampling_t *sampling);
+
+/**
+ * Takes a sample as soon as possible if sampling has stopped because the
+ * resource was not observed. Meant to be called when the resource is read,
+ * which is also how an observation starts. Must be called from the task
+ * running the event loop.
+ */
+void sensor_sampling_kick(sensor_sampling_t *sampling);
@@ -0,0 +1,438 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * LwM2M Object: Sensor Statistics
+ * ID: 32770, Private, Multiple
+ *
+ * Vendor-specific object with aggregated values of a sensor, so that a server
+ * can observe a smoothed value instead of every raw sample. Statistics are
+ * kept over the last Window Size samples and over consecutive intervals of
+ * Interval Length seconds.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+
+#include <anjay/anjay.h>
+#include <avsystem/commons/avs_defs.h>
+#include <avsystem/commons/avs_memory.h>
+
+#include <pico/stdlib.h>
+
+#include "sensor_aggregate.h"
+#include "sensor_sample.h"
+#include "sensor_stats_object.h"
+
+#define SENSOR_STATS_OID 32770
+
+/* Default number of samples in the sliding window */
+#ifndef SENSOR_STATS_DEFAULT_WINDOW_SIZE
+#    define SENSOR_STATS_DEFAULT_WINDOW_SIZE 10
+#endif
+
+/* Default length of an aggregation interval, in seconds */
+#ifndef SENSOR_STATS_DEFAULT_INTERVAL_S
+#    define SENSOR_STATS_DEFAULT_INTERVAL_S 60
+#endif
+
+#define SENSOR_STATS_MAX_INTERVAL_S 86400
+
+/**
+ * Mean Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Mean of the samples in the sliding window.
+ */
+#define RID_MEAN_VALUE 0
+
+/**
+ * Min Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Minimum of the samples in the sliding window.
+ */
+#define RID_MIN_VALUE 1
+
+/**
+ * Max Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Maximum of the samples in the sliding window.
+ */
+#define RID_MAX_VALUE 2
+
+/**
+ * Standard Deviation: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Standard deviation of the samples in the sliding window.
+ */
+#define RID_STD_DEV 3
+
+/**
+ * Window Size: RW, Single, Mandatory
+ * type: integer, range: 1..SENSOR_AGGREGATE_MAX_WINDOW, unit: samples
+ * Number of most recent samples in the sliding window. Changing it clears
+ * the window.
+ */
+#define RID_WINDOW_SIZE 4
+
+/**
+ * Interval Mean Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Mean of the samples in the last completed interval.
+ */
+#define RID_INTERVAL_MEAN_VALUE 5
+
+/**
+ * Interval Min Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Minimum of the samples in the last completed interval.
+ */
+#define RID_INTERVAL_MIN_VALUE 6
+
+/**
+ * Interval Max Value: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Maximum of the samples in the last completed interval.
+ */
+#define RID_INTERVAL_MAX_VALUE 7
+
+/**
+ * Interval Standard Deviation: R, Single, Optional
+ * type: float, range: N/A, unit: N/A
+ * Standard deviation of the samples in the last completed interval.
+ */
+#define RID_INTERVAL_STD_DEV 8
+
+/**
+ * Interval Length: RW, Single, Mandatory
+ * type: integer, range: 1..86400, unit: s
+ * Length of the aggregation interval. Changing it clears the current and last
+ * intervals.
+ */
+#define RID_INTERVAL_LENGTH 9
+
+typedef struct {
+    sensor_sliding_window_t sliding;
+    sensor_tumbling_window_t tumbling;
+    int32_t window_size;
+    int32_t window_size_backup;
+    int32_t interval_s;
+    int32_t interval_s_backup;
+} sensor_stats_instance_t;
+
+typedef struct sensor_stats_object_struct {
+    const anjay_dm_object_def_t *def;
+    anjay_iid_t instance_count;
+    sensor_stats_instance_t instances[];
+} sensor_stats_object_t;
+
+static inline sensor_stats_object_t *
+get_obj(const anjay_dm_object_def_t *const *obj_ptr) {
+    assert(obj_ptr);
+    return AVS_CONTAINER_OF(obj_ptr, sensor_stats_object_t, def);
+}
+
+static void reset_instance(sensor_stats_instance_t *inst) {
+    sensor_sliding_window_reset(&inst->sliding, (uint32_t) inst->window_size);
+    sensor_tumbling_window_reset(&inst->tumbling,
+                                 (uint64_t) inst->interval_s * 1000000);
+}
+
+static double std_dev(const sensor_aggregate_result_t *result) {
+    return sqrt(result->variance) / SENSOR_SAMPLE_SCALE;
+}
+
+static int list_instances(anjay_t *anjay,
+                          const anjay_dm_object_def_t *const *obj_ptr,
+                          anjay_dm_list_ctx_t *ctx) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    for (anjay_iid_t iid = 0; iid < obj->instance_count; iid++) {
+        anjay_dm_emit(ctx, iid);
+    }
+    return 0;
+}
+
+static int list_resources(anjay_t *anjay,
+                          const anjay_dm_object_def_t *const *obj_ptr,
+                          anjay_iid_t iid,
+                          anjay_dm_resource_list_ctx_t *ctx) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    assert(iid < obj->instance_count);
+    const sensor_stats_instance_t *inst = &obj->instances[iid];
+
+    // aggregates are only present once there are samples to aggregate
+    const anjay_dm_resource_presence_t sliding_presence =
+            inst->sliding.sums.count ? ANJAY_DM_RES_PRESENT
+                                     : ANJAY_DM_RES_ABSENT;
+    const anjay_dm_resource_presence_t interval_presence =
+            inst->tumbling.last.count ? ANJAY_DM_RES_PRESENT
+                                      : ANJAY_DM_RES_ABSENT;
+
+    anjay_dm_emit_res(ctx, RID_MEAN_VALUE, ANJAY_DM_RES_R, sliding_presence);
+    anjay_dm_emit_res(ctx, RID_MIN_VALUE, ANJAY_DM_RES_R, sliding_presence);
+    anjay_dm_emit_res(ctx, RID_MAX_VALUE, ANJAY_DM_RES_R, sliding_presence);
+    anjay_dm_emit_res(ctx, RID_STD_DEV, ANJAY_DM_RES_R, sliding_presence);
+    anjay_dm_emit_res(ctx, RID_WINDOW_SIZE, ANJAY_DM_RES_RW,
+                      ANJAY_DM_RES_PRESENT);
+    anjay_dm_emit_res(ctx, RID_INTERVAL_MEAN_VALUE, ANJAY_DM_RES_R,
+                      interval_presence);
+    anjay_dm_emit_res(ctx, RID_INTERVAL_MIN_VALUE, ANJAY_DM_RES_R,
+                      interval_presence);
+    anjay_dm_emit_res(ctx, RID_INTERVAL_MAX_VALUE, ANJAY_DM_RES_R,
+                      interval_presence);
+    anjay_dm_emit_res(ctx, RID_INTERVAL_STD_DEV, ANJAY_DM_RES_R,
+                      interval_presence);
+    anjay_dm_emit_res(ctx, RID_INTERVAL_LENGTH, ANJAY_DM_RES_RW,
+                      ANJAY_DM_RES_PRESENT);
+    return 0;
+}
+
+static int resource_read(anjay_t *anjay,
+                         const anjay_dm_object_def_t *const *obj_ptr,
+                         anjay_iid_t iid,
+                         anjay_rid_t rid,
+                         anjay_riid_t riid,
+                         anjay_output_ctx_t *ctx) {
+    (void) anjay;
+    (void) riid;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    assert(iid < obj->instance_count);
+    const sensor_stats_instance_t *inst = &obj->instances[iid];
+    assert(riid == ANJAY_ID_INVALID);
+
+    const sensor_aggregate_result_t sliding =
+            sensor_sliding_window_get(&inst->sliding);
+    const sensor_aggregate_result_t interval =
+            sensor_tumbling_window_get(&inst->tumbling);
+
+    switch (rid) {
+    case RID_MEAN_VALUE:
+        return anjay_ret_double(ctx, sliding.mean / SENSOR_SAMPLE_SCALE);
+    case RID_MIN_VALUE:
+        return anjay_ret_double(ctx, sensor_sample_to_double(sliding.min));
+    case RID_MAX_VALUE:
+        return anjay_ret_double(ctx, sensor_sample_to_double(sliding.max));
+    case RID_STD_DEV:
+        return anjay_ret_double(ctx, std_dev(&sliding));
+    case RID_WINDOW_SIZE:
+        return anjay_ret_i32(ctx, inst->window_size);
+    case RID_INTERVAL_MEAN_VALUE:
+        return anjay_ret_double(ctx, interval.mean / SENSOR_SAMPLE_SCALE);
+    case RID_INTERVAL_MIN_VALUE:
+        return anjay_ret_double(ctx, sensor_sample_to_double(interval.min));
+    case RID_INTERVAL_MAX_VALUE:
+        return anjay_ret_double(ctx, sensor_sample_to_double(interval.max));
+    case RID_INTERVAL_STD_DEV:
+        return anjay_ret_double(ctx, std_dev(&interval));
+    case RID_INTERVAL_LENGTH:
+        return anjay_ret_i32(ctx, inst->interval_s);
+
+    default:
+        return ANJAY_ERR_METHOD_NOT_ALLOWED;
+    }
+}
+
+static int resource_write(anjay_t *anjay,
+                          const anjay_dm_object_def_t *const *obj_ptr,
+                          anjay_iid_t iid,
+                          anjay_rid_t rid,
+                          anjay_riid_t riid,
+                          anjay_input_ctx_t *ctx) {
+    (void) anjay;
+    (void) riid;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    assert(iid < obj->instance_count);
+    sensor_stats_instance_t *inst = &obj->instances[iid];
+    assert(riid == ANJAY_ID_INVALID);
+
+    switch (rid) {
+    case RID_WINDOW_SIZE:
+        return anjay_get_i32(ctx, &inst->window_size);
+    case RID_INTERVAL_LENGTH:
+        return anjay_get_i32(ctx, &inst->interval_s);
+
+    default:
+        return ANJAY_ERR_METHOD_NOT_ALLOWED;
+    }
+}
+
+static int transaction_begin(anjay_t *anjay,
+                             const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    for (anjay_iid_t iid = 0; iid < obj->instance_count; iid++) {
+        sensor_stats_instance_t *inst = &obj->instances[iid];
+        inst->window_size_backup = inst->window_size;
+        inst->interval_s_backup = inst->interval_s;
+    }
+    return 0;
+}
+
+static int transaction_validate(anjay_t *anjay,
+                                const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    for (anjay_iid_t iid = 0; iid < obj->instance_count; iid++) {
+        const sensor_stats_instance_t *inst = &obj->instances[iid];
+        if (inst->window_size < 1
+                || inst->window_size > SENSOR_AGGREGATE_MAX_WINDOW
+                || inst->interval_s < 1
+                || inst->interval_s > SENSOR_STATS_MAX_INTERVAL_S) {
+            return ANJAY_ERR_BAD_REQUEST;
+        }
+    }
+    return 0;
+}
+
+static int transaction_commit(anjay_t *anjay,
+                              const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    for (anjay_iid_t iid = 0; iid < obj->instance_count; iid++) {
+        sensor_stats_instance_t *inst = &obj->instances[iid];
+        if (inst->window_size != inst->window_size_backup) {
+            sensor_sliding_window_reset(&inst->sliding,
+                                        (uint32_t) inst->window_size);
+        }
+        if (inst->interval_s != inst->interval_s_backup) {
+            sensor_tumbling_window_reset(&inst->tumbling,
+                                         (uint64_t) inst->interval_s
+                                                 * 1000000);
+        }
+    }
+    return 0;
+}
+
+static int transaction_rollback(anjay_t *anjay,
+                                const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    sensor_stats_object_t *obj = get_obj(obj_ptr);
+    for (anjay_iid_t iid = 0; iid < obj->instance_count; iid++) {
+        sensor_stats_instance_t *inst = &obj->instances[iid];
+        inst->window_size = inst->window_size_backup;
+        inst->interval_s = inst->interval_s_backup;
+    }
+    return 0;
+}
+
+static const anjay_dm_object_def_t OBJ_DEF = {
+    .oid = SENSOR_STATS_OID,
+    .handlers = {
+        .list_instances = list_instances,
+
+        .list_resources = list_resources,
+        .resource_read = resource_read,
+        .resource_write = resource_write,
+
+        .transaction_begin = transaction_begin,
+        .transaction_validate = transaction_validate,
+        .transaction_commit = transaction_commit,
+        .transaction_rollback = transaction_rollback
+    }
+};
+
+const anjay_dm_object_def_t **
+sensor_stats_object_create(anjay_iid_t instance_count) {
+    sensor_stats_object_t *obj = (sensor_stats_object_t *) avs_calloc(
+            1, sizeof(sensor_stats_object_t)
+                       + instance_count * sizeof(sensor_stats_instance_t));
+    if (!obj) {
+        return NULL;
+    }
+    obj->def = &OBJ_DEF;
+    obj->instance_count = instance_count;
+    for (anjay_iid_t iid = 0; iid < instance_count; iid++) {
+        sensor_stats_instance_t *inst = &obj->instances[iid];
+        inst->window_size = SENSOR_STATS_DEFAULT_WINDOW_SIZE;
+        inst->interval_s = SENSOR_STATS_DEFAULT_INTERVAL_S;
+        reset_instance(inst);
+    }
+    return &obj->def;
+}
+
+void sensor_stats_object_release(const anjay_dm_object_def_t **def) {
+    if (def) {
+        avs_free(get_obj(def));
+    }
+}
+
+/* Notifies Anjay about a change of the resource, if any server observes it.
+ * anjay_notify_changed() is comparatively costly, as it schedules a job that
+ * goes through all observations, so it is skipped when nobody is listening,
+ * the same way as in sensor_change_filter_check_resource(). */
+static void notify_changed(anjay_t *anjay, anjay_iid_t iid, anjay_rid_t rid) {
+#ifdef ANJAY_WITH_OBSERVATION_STATUS
+    if (!anjay_resource_observation_status(anjay, SENSOR_STATS_OID, iid, rid)
+                 .is_observed) {
+        return;
+    }
+#endif // ANJAY_WITH_OBSERVATION_STATUS
+    anjay_notify_changed(anjay, SENSOR_STATS_OID, iid, rid);
+}
+
+void sensor_stats_object_add_sample(anjay_t *anjay,
+                                    const anjay_dm_object_def_t **def,
+                                    anjay_iid_t iid,
+                                    int32_t value) {
+    if (!def) {
+        return;
+    }
+    sensor_stats_object_t *obj = get_obj(def);
+    if (iid >= obj->instance_count) {
+        return;
+    }
+    sensor_stats_instance_t *inst = &obj->instances[iid];
+
+    const sensor_aggregate_result_t before =
+            sensor_sliding_window_get(&inst->sliding);
+    sensor_sliding_window_add(&inst->sliding, value);
+    const sensor_aggregate_result_t after =
+            sensor_sliding_window_get(&inst->sliding);
+    const bool interval_completed =
+            sensor_tumbling_window_add(&inst->tumbling, time_us_64(), value);
+
+    // e.g. min and max stay the same for most samples of a steady signal;
+    // the first sample makes all of them present
+    const bool first = !before.count;
+    if (first || after.mean != before.mean) {
+        notify_changed(anjay, iid, RID_MEAN_VALUE);
+    }
+    if (first || after.min != before.min) {
+        notify_changed(anjay, iid, RID_MIN_VALUE);
+    }
+    if (first || after.max != before.max) {
+        notify_changed(anjay, iid, RID_MAX_VALUE);
+    }
+    if (first || after.variance != before.variance) {
+        notify_changed(anjay, iid, RID_STD_DEV);
+    }
+    if (interval_completed) {
+        notify_changed(anjay, iid, RID_INTERVAL_MEAN_VALUE);
+        notify_changed(anjay, iid, RID_INTERVAL_MIN_VALUE);
+        notify_changed(anjay, iid, RID_INTERVAL_MAX_VALUE);
+        notify_changed(anjay, iid, RID_INTERVAL_STD_DEV);
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <anjay/dm.h>
+
+/**
+ * Creates the Sensor Statistics object with one instance per sensor. Instance
+ * IDs match those of the sensor object the samples come from.
+ */
+const anjay_dm_object_def_t **
+sensor_stats_object_create(anjay_iid_t instance_count);
+
+void sensor_stats_object_release(const anjay_dm_object_def_t **def);
+
+/**
+ * Adds a fixed-point sample (see sensor_sample.h) to the statistics of
+ * instance iid and notifies Anjay about the resources whose value has changed
+ * and which are observed by any server.
+ */
+void sensor_stats_object_add_sample(anjay_t *anjay,
+                                    const anjay_dm_object_def_t **def,
+                                    anjay_iid_t iid,
+                                    int32_t value);
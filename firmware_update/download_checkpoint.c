@@ -0,0 +1,184 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#include <avsystem/commons/avs_defs.h>
+
+#include "download_checkpoint.h"
+
+#define PACKAGE_MAGIC 0x48445746 // "FWDH"
+#define CHECKPOINT_MAGIC 0x43445746 // "FWDC"
+
+/* Page 0 holds the package header, the other ones hold checkpoints */
+#define FIRST_CHECKPOINT_PAGE 1
+#define PAGES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+typedef struct {
+    uint32_t magic;
+    download_checkpoint_package_t package;
+    /* covers the fields above */
+    uint8_t check;
+} package_page_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t size;
+    uint8_t data[DOWNLOAD_CHECKPOINT_DATA_MAX_SIZE];
+    /* covers the fields above */
+    uint8_t check;
+} checkpoint_page_t;
+
+AVS_STATIC_ASSERT(sizeof(package_page_t) <= FLASH_PAGE_SIZE,
+                  package_page_size);
+AVS_STATIC_ASSERT(sizeof(checkpoint_page_t) <= FLASH_PAGE_SIZE,
+                  checkpoint_page_size);
+
+static uint32_t sector_offset;
+static uint32_t next_page;
+static package_page_t package_page;
+
+/* Page image for programming, erased outside of the bytes being written */
+static uint8_t page_buf[FLASH_PAGE_SIZE];
+
+/* CRC-8 with polynomial x^8 + x^2 + x + 1 */
+static uint8_t crc8(const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (uint8_t) ((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static const void *page_address(uint32_t flash_offset, uint32_t page) {
+    // the flash is memory-mapped, and the SDK flushes the XIP cache after
+    // every erase and program
+    return (const void *) (XIP_BASE + flash_offset + page * FLASH_PAGE_SIZE);
+}
+
+static void erase_sector(uint32_t flash_offset) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(flash_offset, FLASH_SECTOR_SIZE);
+    restore_interrupts(interrupts);
+}
+
+static void program_page(uint32_t page, const void *data, size_t size) {
+    memset(page_buf, 0xFF, sizeof(page_buf));
+    memcpy(page_buf, data, size);
+    const uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_program(sector_offset + page * FLASH_PAGE_SIZE, page_buf,
+                        sizeof(page_buf));
+    restore_interrupts(interrupts);
+}
+
+static void write_package_page(void) {
+    erase_sector(sector_offset);
+    program_page(0, &package_page, sizeof(package_page));
+    next_page = FIRST_CHECKPOINT_PAGE;
+}
+
+void download_checkpoint_start(uint32_t flash_offset,
+                               const download_checkpoint_package_t *package) {
+    assert(flash_offset % FLASH_SECTOR_SIZE == 0);
+    assert(package->etag_size <= DOWNLOAD_CHECKPOINT_ETAG_MAX_SIZE);
+
+    sector_offset = flash_offset;
+    memset(&package_page, 0, sizeof(package_page));
+    package_page.magic = PACKAGE_MAGIC;
+    package_page.package = *package;
+    package_page.check =
+            crc8(&package_page, offsetof(package_page_t, check));
+    write_package_page();
+}
+
+void download_checkpoint_save(const void *data, size_t size) {
+    assert(package_page.magic == PACKAGE_MAGIC);
+    assert(size <= DOWNLOAD_CHECKPOINT_DATA_MAX_SIZE);
+
+    if (next_page == PAGES_PER_SECTOR) {
+        // the previous checkpoint is lost until the new one is written
+        write_package_page();
+    }
+    checkpoint_page_t page;
+    memset(&page, 0, sizeof(page));
+    page.magic = CHECKPOINT_MAGIC;
+    page.size = (uint16_t) size;
+    memcpy(page.data, data, size);
+    page.check = crc8(&page, offsetof(checkpoint_page_t, check));
+    program_page(next_page++, &page, sizeof(page));
+}
+
+void download_checkpoint_clear(uint32_t flash_offset) {
+    const uint8_t *sector = (const uint8_t *) page_address(flash_offset, 0);
+    for (size_t i = 0; i < FLASH_SECTOR_SIZE; i++) {
+        if (sector[i] != 0xFF) {
+            erase_sector(flash_offset);
+            break;
+        }
+    }
+    memset(&package_page, 0, sizeof(package_page));
+}
+
+int download_checkpoint_load(uint32_t flash_offset,
+                             download_checkpoint_package_t *out_package,
+                             void *out_data,
+                             size_t size) {
+    package_page_t package;
+    memcpy(&package, page_address(flash_offset, 0), sizeof(package));
+    if (package.magic != PACKAGE_MAGIC
+            || package.check != crc8(&package, offsetof(package_page_t, check))
+            || package.package.etag_size > DOWNLOAD_CHECKPOINT_ETAG_MAX_SIZE) {
+        return -1;
+    }
+
+    // checkpoints are appended in order; a page that has not been completely
+    // written ends the sequence
+    checkpoint_page_t latest;
+    uint32_t page = FIRST_CHECKPOINT_PAGE;
+    for (; page < PAGES_PER_SECTOR; page++) {
+        checkpoint_page_t candidate;
+        memcpy(&candidate, page_address(flash_offset, page),
+               sizeof(candidate));
+        if (candidate.magic != CHECKPOINT_MAGIC
+                || candidate.check
+                               != crc8(&candidate,
+                                       offsetof(checkpoint_page_t, check))) {
+            break;
+        }
+        latest = candidate;
+    }
+    if (page == FIRST_CHECKPOINT_PAGE || latest.size != size) {
+        return -1;
+    }
+
+    sector_offset = flash_offset;
+    package_page = package;
+    // the sequence might have been ended by a torn write, so the next
+    // checkpoint starts a new sector
+    next_page = PAGES_PER_SECTOR;
+    *out_package = package.package;
+    out_package->uri[DOWNLOAD_CHECKPOINT_URI_SIZE - 1] = '\0';
+    memcpy(out_data, latest.data, size);
+    return 0;
+}
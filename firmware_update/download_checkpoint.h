@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Progress of an interrupted download, kept in a single flash sector so that
+ * the download can be resumed after a restart. The first page of the sector
+ * identifies the package (its URI and ETag); each following page holds one
+ * checkpoint, i.e. an opaque snapshot of the download state. Checkpoints are
+ * appended until the sector is full, after which it is erased and the header
+ * is written again, so the sector is erased once every
+ * DOWNLOAD_CHECKPOINT_SLOTS checkpoints.
+ *
+ * The functions that modify the sector erase and program flash, so they must
+ * be called where it is safe to do so, e.g. from within flash_safe_execute().
+ */
+
+#define DOWNLOAD_CHECKPOINT_URI_SIZE 240
+#define DOWNLOAD_CHECKPOINT_ETAG_MAX_SIZE 8
+#define DOWNLOAD_CHECKPOINT_DATA_MAX_SIZE 248
+
+typedef struct {
+    char uri[DOWNLOAD_CHECKPOINT_URI_SIZE];
+    uint8_t etag_size;
+    uint8_t etag[DOWNLOAD_CHECKPOINT_ETAG_MAX_SIZE];
+} download_checkpoint_package_t;
+
+/**
+ * Erases the checkpoint sector at flash_offset and writes the package header
+ * to it, discarding any previous checkpoints.
+ */
+void download_checkpoint_start(uint32_t flash_offset,
+                               const download_checkpoint_package_t *package);
+
+/**
+ * Appends a checkpoint of size bytes (at most
+ * DOWNLOAD_CHECKPOINT_DATA_MAX_SIZE) to the sector set up with
+ * download_checkpoint_start().
+ */
+void download_checkpoint_save(const void *data, size_t size);
+
+/**
+ * Erases the checkpoint sector at flash_offset, unless it is already erased.
+ */
+void download_checkpoint_clear(uint32_t flash_offset);
+
+/**
+ * Reads the package header and the latest checkpoint from the sector at
+ * flash_offset, and makes further download_checkpoint_save() calls append to
+ * it. Returns -1 if there is no checkpoint, or if it is not exactly size
+ * bytes long.
+ */
+int download_checkpoint_load(uint32_t flash_offset,
+                             download_checkpoint_package_t *out_package,
+                             void *out_data,
+                             size_t size);
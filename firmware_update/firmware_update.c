@@ -15,8 +15,10 @@
  */
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <anjay/anjay.h>
 #include <anjay/fw_update.h>
@@ -25,34 +27,241 @@
 #include <avsystem/commons/avs_log.h>
 #include <avsystem/commons/avs_sched.h>
 #include <avsystem/commons/avs_time.h>
+#include <avsystem/commons/avs_utils.h>
+
+#include <mbedtls/sha256.h>
 
 #include <pico_fota_bootloader.h>
 
 #include "hardware/flash.h"
 #include "hardware/sync.h"
 #include "hardware/watchdog.h"
+#include "pico/stdlib.h"
 
+#include "download_checkpoint.h"
 #include "firmware_update.h"
 #include "flash_aligned_writer.h"
 
+/* Maximum amount of buffered data programmed at once; must be a multiple of
+ * PFB_ALIGN_SIZE */
+#ifndef FW_UPDATE_WRITE_BUF_SIZE
+#    define FW_UPDATE_WRITE_BUF_SIZE (16 * PFB_ALIGN_SIZE)
+#endif
+
+AVS_STATIC_ASSERT(FW_UPDATE_WRITE_BUF_SIZE % PFB_ALIGN_SIZE == 0,
+                  write_buf_size_aligned);
+
 static bool update_initialized;
 static size_t downloaded_bytes;
+static uint64_t download_start_us;
+
+/* Location of the download slot in flash, defined by the pico_fota_bootloader
+ * linker script the application is linked with */
+#ifndef FW_UPDATE_DOWNLOAD_SLOT_OFFSET
+extern char __FLASH_DOWNLOAD_SLOT_START[];
+extern char __FLASH_SWAP_SPACE_LENGTH[];
+#    define FW_UPDATE_DOWNLOAD_SLOT_OFFSET \
+        ((uint32_t) ((uintptr_t) __FLASH_DOWNLOAD_SLOT_START - XIP_BASE))
+#    define FW_UPDATE_DOWNLOAD_SLOT_SIZE \
+        ((uint32_t) (uintptr_t) __FLASH_SWAP_SPACE_LENGTH)
+#endif
+
+/* The last sector of the download slot holds the checkpoints of the download
+ * in progress (see download_checkpoint.h), so the image must fit before it */
+#define FW_UPDATE_CHECKPOINT_OFFSET                                 \
+    (FW_UPDATE_DOWNLOAD_SLOT_OFFSET + FW_UPDATE_DOWNLOAD_SLOT_SIZE \
+     - FLASH_SECTOR_SIZE)
+#define FW_UPDATE_IMAGE_MAX_SIZE \
+    (FW_UPDATE_DOWNLOAD_SLOT_SIZE - FLASH_SECTOR_SIZE)
 
-static uint8_t writer_buf[PFB_ALIGN_SIZE];
+/* The download slot is erased sector by sector, just before the data is first
+ * programmed to each of them, by the task writing the data; this is the size
+ * of its erased part */
+static size_t erased_bytes;
+
+/* Data received in multiples of PFB_ALIGN_SIZE is programmed straight from
+ * the buffers passed to fw_stream_write(), without copying it; only the rest
+ * goes through this one */
+static uint8_t writer_buf[FW_UPDATE_WRITE_BUF_SIZE];
 static flash_aligned_writer_t writer;
 
+/* The build scripts append the SHA-256 of the image to it */
+#define FW_SHA256_DIGEST_SIZE 32
+
+/* SHA-256 of the image, updated as the data is downloaded, so that finishing
+ * the download does not have to read the whole image back from flash. The
+ * last FW_SHA256_DIGEST_SIZE bytes received so far are held back, as they
+ * are the expected digest if no more data follows. */
+static mbedtls_sha256_context sha256;
+static uint8_t sha256_tail[FW_SHA256_DIGEST_SIZE];
+static size_t sha256_tail_len;
+
+static int sha256_start(void) {
+    mbedtls_sha256_init(&sha256);
+    sha256_tail_len = 0;
+    return mbedtls_sha256_starts_ret(&sha256, 0);
+}
+
+static int sha256_update(const uint8_t *data, size_t length) {
+    const size_t total = sha256_tail_len + length;
+    if (total <= FW_SHA256_DIGEST_SIZE) {
+        memcpy(&sha256_tail[sha256_tail_len], data, length);
+        sha256_tail_len = total;
+        return 0;
+    }
+
+    // everything but the last FW_SHA256_DIGEST_SIZE bytes is part of the
+    // image, starting with the bytes held back so far
+    const size_t to_hash = total - FW_SHA256_DIGEST_SIZE;
+    const size_t from_tail = AVS_MIN(sha256_tail_len, to_hash);
+    if (mbedtls_sha256_update_ret(&sha256, sha256_tail, from_tail)
+            || mbedtls_sha256_update_ret(&sha256, data, to_hash - from_tail)) {
+        return -1;
+    }
+    memmove(sha256_tail, &sha256_tail[from_tail], sha256_tail_len - from_tail);
+    sha256_tail_len -= from_tail;
+    const size_t from_data = to_hash - from_tail;
+    memcpy(&sha256_tail[sha256_tail_len], &data[from_data],
+           length - from_data);
+    sha256_tail_len += length - from_data;
+    return 0;
+}
+
+static int sha256_verify(void) {
+    uint8_t digest[FW_SHA256_DIGEST_SIZE];
+    const int result =
+            sha256_tail_len == FW_SHA256_DIGEST_SIZE
+                            && !mbedtls_sha256_finish_ret(&sha256, digest)
+                            && !memcmp(digest, sha256_tail, sizeof(digest))
+                    ? 0
+                    : -1;
+    mbedtls_sha256_free(&sha256);
+    return result;
+}
+
+/* State of the download as of the end of the data programmed so far. It is
+ * saved every time that data ends at a sector boundary, so that the download
+ * can be resumed from there after a restart. */
+typedef struct {
+    uint32_t offset_bytes;
+    uint32_t sha256_tail_len;
+    uint8_t sha256_tail[FW_SHA256_DIGEST_SIZE];
+    mbedtls_sha256_context sha256;
+} checkpoint_t;
+
+AVS_STATIC_ASSERT(sizeof(checkpoint_t) <= DOWNLOAD_CHECKPOINT_DATA_MAX_SIZE,
+                  checkpoint_size);
+
+/* Checkpoints are only saved if the download can be resumed, i.e. it has been
+ * started from a Package URI and the server has provided an ETag */
+static bool checkpoints_enabled;
+static download_checkpoint_package_t package;
+
+/* Set when the download fails because of the package itself, as reported to
+ * Anjay by fw_stream_finish(), so that fw_reset() does not keep it for
+ * resuming */
+static bool package_rejected;
+
+/* anjay_etag_t is followed by the rest of its value */
+static union {
+    anjay_etag_t etag;
+    uint8_t storage[sizeof(anjay_etag_t) + DOWNLOAD_CHECKPOINT_ETAG_MAX_SIZE];
+} resume_etag;
+
+static int write_to_flash(uint8_t *src, size_t offset_bytes, size_t len_bytes) {
+    const size_t end_bytes =
+            AVS_MIN(offset_bytes + len_bytes + FLASH_SECTOR_SIZE - 1,
+                    FW_UPDATE_IMAGE_MAX_SIZE)
+            / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+    if (end_bytes > erased_bytes) {
+        const uint32_t interrupts = save_and_disable_interrupts();
+        flash_range_erase(FW_UPDATE_DOWNLOAD_SLOT_OFFSET + erased_bytes,
+                          end_bytes - erased_bytes);
+        restore_interrupts(interrupts);
+        erased_bytes = end_bytes;
+    }
+    int res = pfb_write_to_flash_aligned_256_bytes(src, offset_bytes,
+                                                   len_bytes);
+    if (res) {
+        return res;
+    }
+    // the digest is computed from the received data, so programming errors
+    // are caught by reading the pages back
+    if (memcmp((const void *) (XIP_BASE + FW_UPDATE_DOWNLOAD_SLOT_OFFSET
+                               + offset_bytes),
+               src, len_bytes)) {
+        avs_log(fw_update, ERROR,
+                "Flash verification failed at offset %zu, length %zu",
+                offset_bytes, len_bytes);
+        return -1;
+    }
+    return 0;
+}
+
+/* Called by the flash aligned writer with consecutive parts of the image */
+static int write_chunk(uint8_t *src, size_t offset_bytes, size_t len_bytes) {
+    const size_t end_bytes = offset_bytes + len_bytes;
+    if (end_bytes > FW_UPDATE_IMAGE_MAX_SIZE || sha256_update(src, len_bytes)) {
+        return -1;
+    }
+    int res = write_to_flash(src, offset_bytes, len_bytes);
+    if (res) {
+        return res;
+    }
+    if (checkpoints_enabled && end_bytes % FLASH_SECTOR_SIZE == 0) {
+        checkpoint_t checkpoint = {
+            .offset_bytes = (uint32_t) end_bytes,
+            .sha256_tail_len = (uint32_t) sha256_tail_len
+        };
+        memcpy(checkpoint.sha256_tail, sha256_tail, sizeof(sha256_tail));
+        mbedtls_sha256_clone(&checkpoint.sha256, &sha256);
+        download_checkpoint_save(&checkpoint, sizeof(checkpoint));
+    }
+    return 0;
+}
+
+static void writer_init(size_t offset_bytes) {
+    flash_aligned_writer_new(writer_buf, sizeof(writer_buf), PFB_ALIGN_SIZE,
+                             write_chunk, &writer);
+    writer.write_offset_bytes = offset_bytes;
+}
+
+/* Makes sure that the download of a rejected package is not resumed after a
+ * restart */
+static void discard_checkpoint(void) {
+    download_checkpoint_clear(FW_UPDATE_CHECKPOINT_OFFSET);
+}
+
 static int fw_stream_open(void *user_ptr,
                           const char *package_uri,
                           const struct anjay_etag *package_etag) {
     (void) user_ptr;
-    (void) package_uri;
-    (void) package_etag;
 
-    pfb_initialize_download_slot();
-    flash_aligned_writer_new(writer_buf, AVS_ARRAY_SIZE(writer_buf),
-                             pfb_write_to_flash_aligned_256_bytes, &writer);
+    checkpoints_enabled = package_uri && package_etag
+                          && strlen(package_uri) < sizeof(package.uri)
+                          && package_etag->size <= sizeof(package.etag);
+    if (checkpoints_enabled) {
+        memset(&package, 0, sizeof(package));
+        strcpy(package.uri, package_uri);
+        package.etag_size = package_etag->size;
+        memcpy(package.etag, package_etag->value, package_etag->size);
+    }
+    erased_bytes = 0;
+    package_rejected = false;
+    pfb_mark_download_slot_as_invalid();
+    if (checkpoints_enabled) {
+        download_checkpoint_start(FW_UPDATE_CHECKPOINT_OFFSET, &package);
+    } else {
+        download_checkpoint_clear(FW_UPDATE_CHECKPOINT_OFFSET);
+    }
+    writer_init(0);
+    if (sha256_start()) {
+        mbedtls_sha256_free(&sha256);
+        return -1;
+    }
 
     downloaded_bytes = 0;
+    download_start_us = time_us_64();
     update_initialized = true;
     avs_log(fw_update, INFO, "Init successful");
 
@@ -63,6 +272,7 @@ static int fw_stream_write(void *user_ptr, const void *data, size_t length) {
 
     assert(update_initialized);
 
+    // the data is hashed as it is passed to write_chunk()
     int res = flash_aligned_writer_write(&writer, data, length);
     if (res) {
         return res;
@@ -80,19 +290,43 @@ static int fw_stream_finish(void *user_ptr) {
     assert(update_initialized);
     update_initialized = false;
 
+    // pico_fota_bootloader images are made of whole pages, the last one
+    // ending with the digest
+    if (downloaded_bytes % PFB_ALIGN_SIZE
+            || downloaded_bytes < FW_SHA256_DIGEST_SIZE) {
+        avs_log(fw_update, ERROR, "Not a pico_fota_bootloader image: %zu bytes",
+                downloaded_bytes);
+        mbedtls_sha256_free(&sha256);
+        package_rejected = true;
+        return ANJAY_FW_UPDATE_ERR_UNSUPPORTED_PACKAGE_TYPE;
+    }
+
     int res = flash_aligned_writer_flush(&writer);
     if (res) {
         avs_log(fw_update, ERROR,
                 "Failed to finish download: flash aligned writer flush failed, "
                 "result: %d",
                 res);
+        mbedtls_sha256_free(&sha256);
         return -1;
     }
 
-    if (pfb_firmware_sha256_check(downloaded_bytes)) {
+    // the digest has been computed during the download, see sha256_update()
+    if (sha256_verify()) {
         avs_log(fw_update, ERROR, "SHA256 check failed");
-        return -1;
+        package_rejected = true;
+        return ANJAY_FW_UPDATE_ERR_INTEGRITY_FAILURE;
     }
+    // the download is complete, so there is nothing left to resume
+    download_checkpoint_clear(FW_UPDATE_CHECKPOINT_OFFSET);
+    checkpoints_enabled = false;
+
+    const uint64_t elapsed_us = time_us_64() - download_start_us;
+    avs_log(fw_update, INFO,
+            "Downloaded %zu bytes in %" PRIu64 " ms (%" PRIu64 " B/s)",
+            downloaded_bytes, elapsed_us / 1000,
+            elapsed_us ? downloaded_bytes * UINT64_C(1000000) / elapsed_us
+                       : 0);
 
     return 0;
 }
@@ -100,6 +334,23 @@ static int fw_stream_finish(void *user_ptr) {
 static void fw_reset(void *user_ptr) {
     (void) user_ptr;
 
+    // Anjay resets the download after it fails, and reports the error
+    // returned by the failed handler as the Update Result. If the package has
+    // been rejected, i.e. it fails the integrity check or is not an image
+    // this device can install, resuming its download would be wrong.
+    // Otherwise, the download has been interrupted, e.g. by a connection or
+    // transport error, so the last checkpoint is kept for it to be resumed
+    // after a restart.
+    if (package_rejected) {
+        discard_checkpoint();
+    } else if (checkpoints_enabled) {
+        avs_log(fw_update, WARNING, "Download interrupted, keeping the "
+                                    "checkpoint");
+    }
+
+    if (update_initialized) {
+        mbedtls_sha256_free(&sha256);
+    }
     update_initialized = false;
 }
 
@@ -129,6 +380,41 @@ static const anjay_fw_update_handlers_t handlers = {
     .perform_upgrade = fw_perform_upgrade
 };
 
+static int restore_download(anjay_fw_update_initial_state_t *state) {
+    checkpoint_t checkpoint;
+    if (download_checkpoint_load(FW_UPDATE_CHECKPOINT_OFFSET, &package,
+                                 &checkpoint, sizeof(checkpoint))
+            || checkpoint.offset_bytes % FLASH_SECTOR_SIZE
+            || checkpoint.offset_bytes > FW_UPDATE_IMAGE_MAX_SIZE
+            || checkpoint.sha256_tail_len > FW_SHA256_DIGEST_SIZE) {
+        return -1;
+    }
+
+    mbedtls_sha256_init(&sha256);
+    mbedtls_sha256_clone(&sha256, &checkpoint.sha256);
+    memcpy(sha256_tail, checkpoint.sha256_tail, sizeof(sha256_tail));
+    sha256_tail_len = checkpoint.sha256_tail_len;
+    // everything past the checkpoint might have been partially programmed,
+    // so it is erased again
+    erased_bytes = checkpoint.offset_bytes;
+    package_rejected = false;
+    writer_init(checkpoint.offset_bytes);
+    checkpoints_enabled = true;
+    downloaded_bytes = checkpoint.offset_bytes;
+    download_start_us = time_us_64();
+    update_initialized = true;
+
+    resume_etag.etag.size = package.etag_size;
+    memcpy(resume_etag.etag.value, package.etag, package.etag_size);
+    state->result = ANJAY_FW_UPDATE_INITIAL_DOWNLOADING;
+    state->persisted_uri = package.uri;
+    state->resume_offset = checkpoint.offset_bytes;
+    state->resume_etag = &resume_etag.etag;
+    avs_log(fw_update, INFO, "Resuming the download of %s from %" PRIu32,
+            package.uri, checkpoint.offset_bytes);
+    return 0;
+}
+
 int fw_update_install(anjay_t *anjay) {
     anjay_fw_update_initial_state_t state = { 0 };
 
@@ -138,6 +424,8 @@ int fw_update_install(anjay_t *anjay) {
     } else if (pfb_is_after_rollback()) {
         state.result = ANJAY_FW_UPDATE_INITIAL_NEUTRAL;
         avs_log(fw_update, WARNING, "Rollback performed");
+    } else {
+        restore_download(&state);
     }
 
     return anjay_fw_update_install(anjay, &handlers, anjay, &state);
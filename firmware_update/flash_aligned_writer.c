@@ -17,6 +17,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <avsystem/commons/avs_utils.h>
 
@@ -24,26 +25,70 @@
 
 void flash_aligned_writer_new(uint8_t *batch_buf,
                               size_t batch_buf_max_len_bytes,
+                              size_t align_bytes,
                               flash_aligned_writer_cb_t *writer_cb,
                               flash_aligned_writer_t *out_writer) {
     assert(batch_buf);
     assert(batch_buf_max_len_bytes);
+    assert(!align_bytes || batch_buf_max_len_bytes % align_bytes == 0);
     assert(writer_cb);
 
     out_writer->batch_buf = batch_buf;
     out_writer->batch_buf_max_len_bytes = batch_buf_max_len_bytes;
     out_writer->batch_buf_len_bytes = 0;
+    out_writer->align_bytes = align_bytes;
     out_writer->write_offset_bytes = 0;
     out_writer->writer_cb = writer_cb;
 }
 
+static int write_batch(flash_aligned_writer_t *writer) {
+    int res = writer->writer_cb(writer->batch_buf, writer->write_offset_bytes,
+                                writer->batch_buf_len_bytes);
+    if (res) {
+        return res;
+    }
+    writer->write_offset_bytes += writer->batch_buf_len_bytes;
+    writer->batch_buf_len_bytes = 0;
+    return 0;
+}
+
 int flash_aligned_writer_write(flash_aligned_writer_t *writer,
                                const uint8_t *data,
                                size_t length_bytes) {
     while (length_bytes > 0) {
-        const size_t bytes_to_copy = AVS_MIN(
+        const size_t align = writer->align_bytes;
+        if (align && writer->batch_buf_len_bytes % align == 0
+                && length_bytes >= align) {
+            // write out what has been buffered so far, so that the aligned
+            // part of data can be passed to writer_cb as is
+            if (writer->batch_buf_len_bytes) {
+                int res = write_batch(writer);
+                if (res) {
+                    return res;
+                }
+            }
+            const size_t direct_bytes = length_bytes - length_bytes % align;
+            int res = writer->writer_cb((uint8_t *) (uintptr_t) data,
+                                        writer->write_offset_bytes,
+                                        direct_bytes);
+            if (res) {
+                return res;
+            }
+            writer->write_offset_bytes += direct_bytes;
+            data += direct_bytes;
+            length_bytes -= direct_bytes;
+            continue;
+        }
+
+        size_t bytes_to_copy = AVS_MIN(
                 writer->batch_buf_max_len_bytes - writer->batch_buf_len_bytes,
                 length_bytes);
+        if (align) {
+            // buffer only up to the next aligned offset
+            bytes_to_copy =
+                    AVS_MIN(bytes_to_copy,
+                            align - writer->batch_buf_len_bytes % align);
+        }
         memcpy(writer->batch_buf + writer->batch_buf_len_bytes, data,
                bytes_to_copy);
         data += bytes_to_copy;
@@ -51,14 +96,10 @@ int flash_aligned_writer_write(flash_aligned_writer_t *writer,
         writer->batch_buf_len_bytes += bytes_to_copy;
 
         if (writer->batch_buf_len_bytes == writer->batch_buf_max_len_bytes) {
-            int res = writer->writer_cb(writer->batch_buf,
-                                        writer->write_offset_bytes,
-                                        writer->batch_buf_len_bytes);
+            int res = write_batch(writer);
             if (res) {
                 return res;
             }
-            writer->write_offset_bytes += writer->batch_buf_len_bytes;
-            writer->batch_buf_len_bytes = 0;
         }
     }
 
@@ -70,13 +111,5 @@ int flash_aligned_writer_flush(flash_aligned_writer_t *writer) {
         return 0;
     }
 
-    int res = writer->writer_cb(writer->batch_buf, writer->write_offset_bytes,
-                                writer->batch_buf_len_bytes);
-    if (res) {
-        return res;
-    }
-    writer->write_offset_bytes += writer->batch_buf_len_bytes;
-    writer->batch_buf_len_bytes = 0;
-
-    return 0;
+    return write_batch(writer);
 }
@@ -30,12 +30,22 @@ typedef struct {
     uint8_t *batch_buf;
     size_t batch_buf_max_len_bytes;
     size_t batch_buf_len_bytes;
+    size_t align_bytes;
     size_t write_offset_bytes;
     flash_aligned_writer_cb_t *writer_cb;
 } flash_aligned_writer_t;
 
+/**
+ * If align_bytes is not 0, spans of the written data that are multiples of
+ * align_bytes are passed to writer_cb directly, without copying them into
+ * batch_buf; only the unaligned head and tail are buffered. In that case,
+ * batch_buf_max_len_bytes must be a multiple of align_bytes. Such a span is
+ * the data passed to flash_aligned_writer_write(), so writer_cb must be done
+ * with it before returning.
+ */
 void flash_aligned_writer_new(uint8_t *batch_buf,
                               size_t batch_buf_max_len_bytes,
+                              size_t align_bytes,
                               flash_aligned_writer_cb_t *writer_cb,
                               flash_aligned_writer_t *out_writer);
 int flash_aligned_writer_write(flash_aligned_writer_t *writer,
@@ -20,16 +20,16 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
-#include "lwip/sockets.h"
 #include <anjay/anjay.h>
 #include <anjay/core.h>
 #include <anjay/security.h>
 #include <anjay/server.h>
-#include <avsystem/commons/avs_list.h>
 #include <avsystem/commons/avs_log.h>
 #include <avsystem/commons/avs_prng.h>
 #include <avsystem/commons/avs_time.h>
 
+#include "event_loop.h"
+
 #ifndef RUN_FREERTOS_ON_CORE
 #    define RUN_FREERTOS_ON_CORE 0
 #endif
@@ -100,43 +100,6 @@ static int setup_server_object() {
                                             &server_instance_id);
 }
 
-void main_loop(void) {
-    while (true) {
-        AVS_LIST(avs_net_socket_t *const) sockets = NULL;
-        sockets = anjay_get_sockets(g_anjay);
-
-        size_t numsocks = AVS_LIST_SIZE(sockets);
-        struct pollfd pollfds[numsocks];
-        size_t i = 0;
-        AVS_LIST(avs_net_socket_t *const) sock;
-        AVS_LIST_FOREACH(sock, sockets) {
-            pollfds[i].fd = *(const int *) avs_net_socket_get_system(*sock);
-            pollfds[i].events = POLLIN;
-            pollfds[i].revents = 0;
-            ++i;
-        }
-
-        const int max_wait_time_ms = 1000;
-        int wait_ms = max_wait_time_ms;
-        wait_ms = anjay_sched_calculate_wait_time_ms(g_anjay, max_wait_time_ms);
-
-        if (poll(pollfds, numsocks, wait_ms) > 0) {
-            int socket_id = 0;
-            AVS_LIST(avs_net_socket_t *const) socket = NULL;
-            AVS_LIST_FOREACH(socket, sockets) {
-                if (pollfds[socket_id].revents) {
-                    if (anjay_serve(g_anjay, *socket)) {
-                        avs_log(tutorial, ERROR, "anjay_serve() failed");
-                    }
-                }
-                ++socket_id;
-            }
-        }
-
-        anjay_sched_run(g_anjay);
-    }
-}
-
 void anjay_task(__unused void *params) {
     init_wifi();
 
@@ -157,7 +120,7 @@ void anjay_task(__unused void *params) {
         exit(1);
     }
 
-    main_loop();
+    event_loop_run(g_anjay);
 
     anjay_delete(g_anjay);
 }
@@ -16,215 +16,313 @@
 
 #include <string.h>
 
-#include "ds18b20.h"
-#include "hardware/gpio.h"
 #include "pico/stdlib.h"
 
+#include <avsystem/commons/avs_log.h>
+
+#include "ds18b20.h"
+#include "onewire.h"
+#include "sensor_sample.h"
+
 #define DS18B20_SCRATCHPAD_SIZE 9
-#define DS18B20_ROM_CODE_SIZE 8
+#define DS18B20_ROM_CODE_SIZE ONEWIRE_ROM_CODE_SIZE
+
+#define DS18B20_FAMILY_CODE 0x28
 
-#define DS18B20_READ_ROM 0x33
 #define DS18B20_MATCH_ROM 0x55
 #define DS18B20_SKIP_ROM 0xCC
 
 #define DS18B20_CONVERT_T 0x44
+#define DS18B20_WRITE_SCRATCHPAD 0x4E
 #define DS18B20_READ_SCRATCHPAD 0xBE
 
-static double temperature;
-static uint8_t ds18b20_addr[DS18B20_ROM_CODE_SIZE];
-
-static uint8_t byte_crc(uint8_t crc, uint8_t byte) {
-    uint8_t i;
-    for (i = 0; i < 8; i++) {
-        uint8_t b = crc ^ byte;
-        crc >>= 1;
-        if (b & 0x01) {
-            crc ^= 0x8c;
-        }
-        byte >>= 1;
-    }
-    return crc;
+#define DS18B20_SCRATCHPAD_TH 2
+#define DS18B20_SCRATCHPAD_TL 3
+#define DS18B20_SCRATCHPAD_CONFIG 4
+
+/* R1:R0 bits of the configuration register select the resolution */
+#define DS18B20_CONFIG_RESOLUTION_SHIFT 5
+#define DS18B20_CONFIG_RESERVED_BITS 0x1F
+
+/* Maximum conversion time at 12-bit resolution, halved for each bit less */
+#define DS18B20_CONVERSION_TIME_12BIT_US 750000
+
+/* Power-on value of the temperature register: +85 degrees Celsius */
+#define DS18B20_POWER_ON_TEMP_RAW 0x0550
+
+/* Results of conversions started longer ago than this are discarded, e.g.
+ * after sampling has been paused */
+#define DS18B20_MAX_RESULT_AGE_US 10000000
+
+/* Number of consecutive failed search passes after which the search is given
+ * up; a bus that keeps failing would otherwise never let it finish */
+#define DS18B20_SEARCH_MAX_ERRORS 3
+
+typedef enum {
+    DS18B20_STATE_IDLE,
+    DS18B20_STATE_CONVERTING
+} ds18b20_state_t;
+
+typedef struct {
+    uint8_t rom_code[DS18B20_ROM_CODE_SIZE];
+    /* Latest sample, shared with the Anjay task */
+    sensor_sample_store_t sample;
+} ds18b20_sensor_t;
+
+static ds18b20_sensor_t sensors[DS18B20_MAX_SENSORS];
+static size_t sensor_count;
+static ds18b20_state_t state;
+static uint64_t conversion_start_us;
+
+/* Resolution the sensors are configured with, and the one requested by
+ * ds18b20_set_resolution(), applied between conversions */
+static unsigned resolution_bits;
+static volatile unsigned requested_resolution_bits =
+        DS18B20_DEFAULT_RESOLUTION_BITS;
+
+static uint32_t conversion_time_us(unsigned bits) {
+    return DS18B20_CONVERSION_TIME_12BIT_US >> (DS18B20_MAX_RESOLUTION_BITS
+                                                - bits);
 }
 
-static uint8_t wire_crc(const uint8_t *data, size_t len) {
-    size_t i;
-    uint8_t crc = 0;
-
-    for (i = 0; i < len; i++) {
-        crc = byte_crc(crc, data[i]);
+static size_t ds18b20_search_sensors(void) {
+    onewire_search_t search;
+    onewire_search_init(&search);
+
+    size_t count = 0;
+    unsigned errors = 0;
+    int result;
+    while (count < DS18B20_MAX_SENSORS
+           && (result = onewire_search_next(&search)) != 1) {
+        if (result) {
+            // noise or a device leaving the bus; the search state is not
+            // advanced on a read error, so the same branch is retried
+            if (++errors >= DS18B20_SEARCH_MAX_ERRORS) {
+                avs_log(ds18b20, WARNING,
+                        "1-Wire search failed %u times in a row, giving up "
+                        "with %u sensor(s) found",
+                        errors, (unsigned) count);
+                break;
+            }
+            continue;
+        }
+        errors = 0;
+        if (search.rom_code[0] != DS18B20_FAMILY_CODE) {
+            continue;
+        }
+        memcpy(sensors[count].rom_code, search.rom_code,
+               DS18B20_ROM_CODE_SIZE);
+        ++count;
     }
-
-    return crc;
+    return count;
 }
 
-static int wire_reset(void) {
-    gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);
-    gpio_put(ONEWIRE_PIN, 0);
-    sleep_us(480);
-    gpio_put(ONEWIRE_PIN, 1);
-    sleep_us(70);
-    gpio_set_dir(ONEWIRE_PIN, GPIO_IN);
-    bool rc = gpio_get(ONEWIRE_PIN);
-    sleep_us(410);
+static int send_cmd(const uint8_t *rom_code, uint8_t cmd) {
+    // ROM command, optional ROM code and function command in one transfer
+    uint8_t frame[1 + DS18B20_ROM_CODE_SIZE + 1];
+    size_t len = 0;
 
-    if (rc) {
+    if (onewire_reset()) {
         return 1;
     }
-    return 0;
-}
 
-static void write_bit(int value) {
-    gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);
-    if (value) {
-        gpio_put(ONEWIRE_PIN, 0);
-        sleep_us(6);
-        gpio_put(ONEWIRE_PIN, 1);
-        sleep_us(64);
+    if (!rom_code) {
+        frame[len++] = DS18B20_SKIP_ROM;
     } else {
-        gpio_put(ONEWIRE_PIN, 0);
-        sleep_us(60);
-        gpio_put(ONEWIRE_PIN, 1);
-        sleep_us(10);
+        frame[len++] = DS18B20_MATCH_ROM;
+        memcpy(&frame[len], rom_code, DS18B20_ROM_CODE_SIZE);
+        len += DS18B20_ROM_CODE_SIZE;
     }
+    frame[len++] = cmd;
+    return onewire_write_bytes(frame, len) ? 1 : 0;
 }
 
-static bool read_bit(void) {
-    gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);
-    gpio_put(ONEWIRE_PIN, 0);
-    sleep_us(6);
-    gpio_put(ONEWIRE_PIN, 1);
-    sleep_us(9);
-    gpio_set_dir(ONEWIRE_PIN, GPIO_IN);
-    bool rc = gpio_get(ONEWIRE_PIN);
-    sleep_us(55);
-    return rc;
-}
-
-static void wire_write(uint8_t byte) {
-    uint8_t i;
-    for (i = 0; i < 8; i++) {
-        write_bit(byte & 0x01);
-        byte >>= 1;
-    }
-}
-
-static uint8_t wire_read(void) {
-    uint8_t value = 0;
-    uint8_t i;
-    for (i = 0; i < 8; i++) {
-        value >>= 1;
-        if (read_bit()) {
-            value |= 0x80;
-        }
-    }
-    return value;
-}
-
-static int ds18b20_read_address(uint8_t *rom_code) {
-    int i;
+static int ds18b20_read_scratchpad(const uint8_t *rom_code,
+                                   uint8_t *scratchpad) {
     uint8_t crc;
 
-    if (wire_reset()) {
+    if (send_cmd(rom_code, DS18B20_READ_SCRATCHPAD)
+            || onewire_read_bytes(scratchpad, DS18B20_SCRATCHPAD_SIZE)) {
         return 1;
     }
 
-    wire_write(DS18B20_READ_ROM);
-
-    for (i = 0; i < DS18B20_ROM_CODE_SIZE; i++) {
-        rom_code[i] = wire_read();
-    }
-
-    crc = wire_crc(rom_code, DS18B20_ROM_CODE_SIZE - 1);
-    if (rom_code[DS18B20_ROM_CODE_SIZE - 1] != crc) {
+    crc = onewire_crc8(scratchpad, DS18B20_SCRATCHPAD_SIZE - 1);
+    if (scratchpad[DS18B20_SCRATCHPAD_SIZE - 1] != crc) {
         return 1;
     }
 
     return 0;
 }
 
-static int send_cmd(const uint8_t *rom_code, uint8_t cmd) {
-    int i;
+static int ds18b20_get_temp(const uint8_t *rom_code,
+                            int32_t *out_millicelsius) {
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+    int16_t temp;
 
-    if (wire_reset()) {
+    if (ds18b20_read_scratchpad(rom_code, scratchpad) != 0) {
         return 1;
     }
 
-    if (!rom_code) {
-        wire_write(DS18B20_SKIP_ROM);
-    } else {
-        wire_write(DS18B20_MATCH_ROM);
-        for (i = 0; i < DS18B20_ROM_CODE_SIZE; i++) {
-            wire_write(rom_code[i]);
-        }
+    memcpy(&temp, &scratchpad[0], sizeof(temp));
+    // the power-on value means that no conversion has completed
+    if (temp == DS18B20_POWER_ON_TEMP_RAW) {
+        return 1;
     }
-    wire_write(cmd);
+    // the temperature register is always in 1/16 degree units, but bits below
+    // the configured resolution are undefined
+    temp &= (int16_t) ~((1 << (DS18B20_MAX_RESOLUTION_BITS - resolution_bits))
+                        - 1);
+
+    *out_millicelsius = (int32_t) temp * 1000 / 16;
     return 0;
 }
 
-static int ds18b20_read_scratchpad(const uint8_t *rom_code,
-                                   uint8_t *scratchpad) {
-    int i;
-    uint8_t crc;
+static int ds18b20_start_measure(const uint8_t *rom_code) {
+    return send_cmd(rom_code, DS18B20_CONVERT_T);
+}
+
+static bool ds18b20_conversion_done(void) {
+    // an externally powered DS18B20 answers read slots with 0 while
+    // converting; the timeout covers parasite-powered sensors
+    return time_us_64() - conversion_start_us
+                   >= conversion_time_us(resolution_bits)
+           || onewire_read_bit();
+}
+
+static int ds18b20_write_config(const uint8_t *rom_code, unsigned bits) {
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
 
-    if (send_cmd(rom_code, DS18B20_READ_SCRATCHPAD)) {
+    // TH and TL share the write with the configuration register, so keep
+    // their current values
+    if (ds18b20_read_scratchpad(rom_code, scratchpad)
+            || send_cmd(rom_code, DS18B20_WRITE_SCRATCHPAD)) {
         return 1;
     }
+    const uint8_t data[] = {
+        scratchpad[DS18B20_SCRATCHPAD_TH], scratchpad[DS18B20_SCRATCHPAD_TL],
+        (uint8_t) (((bits - DS18B20_MIN_RESOLUTION_BITS)
+                    << DS18B20_CONFIG_RESOLUTION_SHIFT)
+                   | DS18B20_CONFIG_RESERVED_BITS)
+    };
+    return onewire_write_bytes(data, sizeof(data)) ? 1 : 0;
+}
 
-    for (i = 0; i < DS18B20_SCRATCHPAD_SIZE; i++) {
-        scratchpad[i] = wire_read();
+static void ds18b20_apply_resolution(void) {
+    const unsigned bits = requested_resolution_bits;
+    if (bits == resolution_bits) {
+        return;
     }
 
-    crc = wire_crc(scratchpad, DS18B20_SCRATCHPAD_SIZE - 1);
-    if (scratchpad[DS18B20_SCRATCHPAD_SIZE - 1] != crc) {
-        return 1;
+    int result = 0;
+    for (size_t i = 0; i < sensor_count; i++) {
+        result |= ds18b20_write_config(sensors[i].rom_code, bits);
     }
+    // on failure, some sensors may be left at the new resolution; waiting for
+    // the longer of the two conversion times is correct either way
+    resolution_bits = result ? DS18B20_MAX_RESOLUTION_BITS : bits;
+}
+
+static int ds18b20_start_conversion(void) {
+    ds18b20_apply_resolution();
 
+    // a single broadcast conversion for all sensors on the bus
+    if (ds18b20_start_measure(NULL)) {
+        return -1;
+    }
+    conversion_start_us = time_us_64();
+    state = DS18B20_STATE_CONVERTING;
     return 0;
 }
 
-static double ds18b20_get_temp(const uint8_t *rom_code) {
-    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
-    int16_t temp;
-
-    if (ds18b20_read_scratchpad(rom_code, scratchpad) != 0) {
-        return 85.0;
+int ds18b20_init(void) {
+    onewire_init(ONEWIRE_PIN);
+    sensor_count = ds18b20_search_sensors();
+    if (!sensor_count) {
+        return 1;
     }
 
-    memcpy(&temp, &scratchpad[0], sizeof(temp));
+    for (size_t i = 0; i < sensor_count; i++) {
+        sensor_sample_store_init(&sensors[i].sample);
+    }
+    // unknown until written, forces ds18b20_apply_resolution() to configure
+    // all sensors
+    resolution_bits = 0;
+    state = DS18B20_STATE_IDLE;
+    ds18b20_start_conversion();
+    return 0;
+}
 
-    return temp / 16.0;
+size_t ds18b20_get_sensor_count(void) {
+    return sensor_count;
 }
 
-static int ds18b20_start_measure(const uint8_t *rom_code) {
-    return send_cmd(rom_code, DS18B20_CONVERT_T);
+const uint8_t *ds18b20_get_rom_code(size_t index) {
+    return index < sensor_count ? sensors[index].rom_code : NULL;
 }
 
-int ds18b20_init(void) {
-    gpio_init(ONEWIRE_PIN);
-    gpio_pull_up(ONEWIRE_PIN);
-    if (ds18b20_read_address(ds18b20_addr)) {
-        return 1;
+int ds18b20_set_resolution(unsigned bits) {
+    if (bits < DS18B20_MIN_RESOLUTION_BITS
+            || bits > DS18B20_MAX_RESOLUTION_BITS) {
+        return -1;
     }
-
+    requested_resolution_bits = bits;
     return 0;
 }
 
+unsigned ds18b20_get_resolution(void) {
+    return requested_resolution_bits;
+}
+
+uint32_t ds18b20_get_conversion_time_ms(void) {
+    return (conversion_time_us(requested_resolution_bits) + 999) / 1000;
+}
+
 int ds18b20_release(void) {
-    gpio_deinit(ONEWIRE_PIN);
+    onewire_release();
+    return 0;
 }
 
-int temperature_read_data(void) {
-    ds18b20_start_measure(ds18b20_addr);
-    sleep_ms(750);
-    temperature = ds18b20_get_temp(ds18b20_addr);
-    if (temperature >= 80.0) {
-        return 1;
+int ds18b20_process(void) {
+    switch (state) {
+    case DS18B20_STATE_IDLE:
+        return ds18b20_start_conversion();
+
+    case DS18B20_STATE_CONVERTING: {
+        if (time_us_64() - conversion_start_us > DS18B20_MAX_RESULT_AGE_US) {
+            return ds18b20_start_conversion();
+        }
+        if (!ds18b20_conversion_done()) {
+            return 0;
+        }
+
+        bool any_valid = false;
+        for (size_t i = 0; i < sensor_count; i++) {
+            int32_t value;
+            if (ds18b20_get_temp(sensors[i].rom_code, &value)) {
+                sensor_sample_store_put_error(&sensors[i].sample);
+            } else {
+                sensor_sample_store_put(&sensors[i].sample, value);
+                any_valid = true;
+            }
+        }
+
+        // start the next conversion right away, so that a fresh sample is
+        // ready by the time of the next call
+        state = DS18B20_STATE_IDLE;
+        ds18b20_start_conversion();
+        return any_valid ? 1 : -1;
     }
 
-    return 0;
+    default:
+        return -1;
+    }
 }
 
-int temperature_get_data(double *sensor_data) {
-    *sensor_data = temperature;
-    return 0;
+int temperature_get_data(size_t index, int32_t *out_millicelsius) {
+    if (index >= sensor_count) {
+        return -1;
+    }
+
+    return sensor_sample_store_get_value(&sensors[index].sample,
+                                         out_millicelsius);
 }
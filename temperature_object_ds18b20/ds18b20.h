@@ -16,10 +16,68 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* Pico GPIO pin where the sensor data line is connected */
 #define ONEWIRE_PIN 28
 
+/* Maximum number of sensors discovered on the bus */
+#define DS18B20_MAX_SENSORS 16
+
+/* Conversion resolution: 9, 10, 11 or 12 bits take up to 93.75, 187.5, 375 or
+ * 750 ms respectively */
+#define DS18B20_MIN_RESOLUTION_BITS 9
+#define DS18B20_MAX_RESOLUTION_BITS 12
+#ifndef DS18B20_DEFAULT_RESOLUTION_BITS
+#    define DS18B20_DEFAULT_RESOLUTION_BITS DS18B20_MAX_RESOLUTION_BITS
+#endif
+
+/**
+ * Discovers all DS18B20 sensors on the bus using Search ROM. Returns 0 if at
+ * least one sensor was found.
+ */
 int ds18b20_init(void);
 int ds18b20_release(void);
-int temperature_read_data(void);
-int temperature_get_data(double *sensor_data);
+
+size_t ds18b20_get_sensor_count(void);
+
+/**
+ * Requests a new resolution for all sensors. It is written to their
+ * configuration registers before the next conversion, so this function does
+ * not access the bus and may be called from any task.
+ */
+int ds18b20_set_resolution(unsigned bits);
+unsigned ds18b20_get_resolution(void);
+
+/**
+ * Maximum conversion time at the requested resolution.
+ */
+uint32_t ds18b20_get_conversion_time_ms(void);
+
+/**
+ * Returns the 8-byte ROM code of the sensor with the given index, or NULL if
+ * there is no such sensor.
+ */
+const uint8_t *ds18b20_get_rom_code(size_t index);
+
+/**
+ * Advances the non-blocking conversion state machine: starts a conversion if
+ * none is in progress, or reads the scratchpads if the conversion in progress
+ * has finished and immediately starts the next one. Never waits for the
+ * sensors.
+ *
+ * Conversions are started on all sensors at once with SKIP_ROM, so reading any
+ * number of sensors costs a single conversion time. A conversion whose result
+ * was not collected for a long time is repeated instead.
+ *
+ * Returns 1 if at least one new sample has been stored, 0 if the conversion is
+ * still in progress, or a negative value on a bus error.
+ */
+int ds18b20_process(void);
+
+/**
+ * Returns the latest sample of the given sensor stored by ds18b20_process(),
+ * in millidegrees Celsius, without accessing the bus.
+ */
+int temperature_get_data(size_t index, int32_t *out_millicelsius);
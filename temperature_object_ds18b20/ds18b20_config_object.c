@@ -0,0 +1,197 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * LwM2M Object: DS18B20 Configuration
+ * ID: 32769, Private, Single
+ *
+ * Vendor-specific object that configures all DS18B20 sensors on the bus. Lower
+ * resolution shortens the conversion time, allowing faster sampling.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+
+#include <anjay/anjay.h>
+#include <avsystem/commons/avs_defs.h>
+#include <avsystem/commons/avs_memory.h>
+
+#include "ds18b20.h"
+#include "ds18b20_config_object.h"
+
+#define DS18B20_CONFIG_OID 32769
+
+/**
+ * Resolution: RW, Single, Mandatory
+ * type: integer, range: 9..12, unit: bits
+ * Resolution of the temperature conversions.
+ */
+#define RID_RESOLUTION 0
+
+/**
+ * Conversion Time: R, Single, Mandatory
+ * type: integer, range: N/A, unit: ms
+ * Maximum conversion time at the current resolution.
+ */
+#define RID_CONVERSION_TIME 1
+
+typedef struct ds18b20_config_object_struct {
+    const anjay_dm_object_def_t *def;
+    int32_t resolution;
+    int32_t resolution_backup;
+} ds18b20_config_object_t;
+
+static inline ds18b20_config_object_t *
+get_obj(const anjay_dm_object_def_t *const *obj_ptr) {
+    assert(obj_ptr);
+    return AVS_CONTAINER_OF(obj_ptr, ds18b20_config_object_t, def);
+}
+
+static int list_resources(anjay_t *anjay,
+                          const anjay_dm_object_def_t *const *obj_ptr,
+                          anjay_iid_t iid,
+                          anjay_dm_resource_list_ctx_t *ctx) {
+    (void) anjay;
+    (void) obj_ptr;
+    (void) iid;
+
+    anjay_dm_emit_res(ctx, RID_RESOLUTION, ANJAY_DM_RES_RW,
+                      ANJAY_DM_RES_PRESENT);
+    anjay_dm_emit_res(ctx, RID_CONVERSION_TIME, ANJAY_DM_RES_R,
+                      ANJAY_DM_RES_PRESENT);
+    return 0;
+}
+
+static int resource_read(anjay_t *anjay,
+                         const anjay_dm_object_def_t *const *obj_ptr,
+                         anjay_iid_t iid,
+                         anjay_rid_t rid,
+                         anjay_riid_t riid,
+                         anjay_output_ctx_t *ctx) {
+    (void) anjay;
+    (void) iid;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    assert(obj);
+
+    switch (rid) {
+    case RID_RESOLUTION:
+        assert(riid == ANJAY_ID_INVALID);
+        return anjay_ret_i32(ctx, obj->resolution);
+
+    case RID_CONVERSION_TIME:
+        assert(riid == ANJAY_ID_INVALID);
+        return anjay_ret_i64(ctx, ds18b20_get_conversion_time_ms());
+
+    default:
+        return ANJAY_ERR_METHOD_NOT_ALLOWED;
+    }
+}
+
+static int resource_write(anjay_t *anjay,
+                          const anjay_dm_object_def_t *const *obj_ptr,
+                          anjay_iid_t iid,
+                          anjay_rid_t rid,
+                          anjay_riid_t riid,
+                          anjay_input_ctx_t *ctx) {
+    (void) anjay;
+    (void) iid;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    assert(obj);
+
+    switch (rid) {
+    case RID_RESOLUTION:
+        assert(riid == ANJAY_ID_INVALID);
+        return anjay_get_i32(ctx, &obj->resolution);
+
+    default:
+        return ANJAY_ERR_METHOD_NOT_ALLOWED;
+    }
+}
+
+static int transaction_begin(anjay_t *anjay,
+                             const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    obj->resolution_backup = obj->resolution;
+    return 0;
+}
+
+static int transaction_validate(anjay_t *anjay,
+                                const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    if (obj->resolution < DS18B20_MIN_RESOLUTION_BITS
+            || obj->resolution > DS18B20_MAX_RESOLUTION_BITS) {
+        return ANJAY_ERR_BAD_REQUEST;
+    }
+    return 0;
+}
+
+static int transaction_commit(anjay_t *anjay,
+                              const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    return ds18b20_set_resolution((unsigned) obj->resolution)
+                   ? ANJAY_ERR_INTERNAL
+                   : 0;
+}
+
+static int transaction_rollback(anjay_t *anjay,
+                                const anjay_dm_object_def_t *const *obj_ptr) {
+    (void) anjay;
+
+    ds18b20_config_object_t *obj = get_obj(obj_ptr);
+    obj->resolution = obj->resolution_backup;
+    return 0;
+}
+
+static const anjay_dm_object_def_t OBJ_DEF = {
+    .oid = DS18B20_CONFIG_OID,
+    .handlers = {
+        .list_instances = anjay_dm_list_instances_SINGLE,
+
+        .list_resources = list_resources,
+        .resource_read = resource_read,
+        .resource_write = resource_write,
+
+        .transaction_begin = transaction_begin,
+        .transaction_validate = transaction_validate,
+        .transaction_commit = transaction_commit,
+        .transaction_rollback = transaction_rollback
+    }
+};
+
+const anjay_dm_object_def_t **ds18b20_config_object_create(void) {
+    ds18b20_config_object_t *obj = (ds18b20_config_object_t *) avs_calloc(
+            1, sizeof(ds18b20_config_object_t));
+    if (!obj) {
+        return NULL;
+    }
+    obj->def = &OBJ_DEF;
+    obj->resolution = (int32_t) ds18b20_get_resolution();
+    return &obj->def;
+}
+
+void ds18b20_config_object_release(const anjay_dm_object_def_t **def) {
+    if (def) {
+        avs_free(get_obj(def));
+    }
+}
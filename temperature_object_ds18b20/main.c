@@ -20,33 +20,29 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
-#include "lwip/sockets.h"
 #include <anjay/anjay.h>
 #include <anjay/core.h>
 #include <anjay/security.h>
 #include <anjay/server.h>
-#include <avsystem/commons/avs_list.h>
 #include <avsystem/commons/avs_log.h>
 #include <avsystem/commons/avs_prng.h>
 #include <avsystem/commons/avs_time.h>
 
+#include "event_loop.h"
 #include "temperature_sensor.h"
+#include "wifi_link.h"
 
 #ifndef RUN_FREERTOS_ON_CORE
 #    define RUN_FREERTOS_ON_CORE 0
 #endif
 
 #define ANJAY_TASK_PRIORITY (tskIDLE_PRIORITY + 2UL)
-#define TEMP_UPDATE_TASK_PRIORITY (tskIDLE_PRIORITY + 1UL)
 
 #define ANJAY_TASK_SIZE (4000U)
-#define TEMP_UPDATE_TASK_SIZE (1000U)
 
 static anjay_t *g_anjay;
 static StackType_t anjay_stack[ANJAY_TASK_SIZE];
 static StaticTask_t anjay_task_buffer;
-static StackType_t temp_update_stack[TEMP_UPDATE_TASK_SIZE];
-static StaticTask_t temp_update_task_buffer;
 
 static void init_wifi(void) {
     if (cyw43_arch_init()) {
@@ -106,51 +102,6 @@ static int setup_server_object() {
                                             &server_instance_id);
 }
 
-void main_loop(void) {
-    while (true) {
-        AVS_LIST(avs_net_socket_t *const) sockets = NULL;
-        sockets = anjay_get_sockets(g_anjay);
-
-        size_t numsocks = AVS_LIST_SIZE(sockets);
-        struct pollfd pollfds[numsocks];
-        size_t i = 0;
-        AVS_LIST(avs_net_socket_t *const) sock;
-        AVS_LIST_FOREACH(sock, sockets) {
-            pollfds[i].fd = *(const int *) avs_net_socket_get_system(*sock);
-            pollfds[i].events = POLLIN;
-            pollfds[i].revents = 0;
-            ++i;
-        }
-
-        const int max_wait_time_ms = 1000;
-        int wait_ms = max_wait_time_ms;
-        wait_ms = anjay_sched_calculate_wait_time_ms(g_anjay, max_wait_time_ms);
-
-        if (poll(pollfds, numsocks, wait_ms) > 0) {
-            int socket_id = 0;
-            AVS_LIST(avs_net_socket_t *const) socket = NULL;
-            AVS_LIST_FOREACH(socket, sockets) {
-                if (pollfds[socket_id].revents) {
-                    if (anjay_serve(g_anjay, *socket)) {
-                        avs_log(tutorial, ERROR, "anjay_serve() failed");
-                    }
-                }
-                ++socket_id;
-            }
-        }
-
-        anjay_sched_run(g_anjay);
-    }
-}
-
-void temperature_sensor_update_task(__unused void *params) {
-    const TickType_t delay = 2000 / portTICK_PERIOD_MS;
-    while (true) {
-        temperature_sensor_update(g_anjay);
-        vTaskDelay(delay);
-    }
-}
-
 void anjay_task(__unused void *params) {
     init_wifi();
 
@@ -173,11 +124,12 @@ void anjay_task(__unused void *params) {
 
     temperature_sensor_install(g_anjay);
 
-    xTaskCreateStatic(temperature_sensor_update_task, "TemperatureUpdateTask",
-                      TEMP_UPDATE_TASK_SIZE, NULL, TEMP_UPDATE_TASK_PRIORITY,
-                      temp_update_stack, &temp_update_task_buffer);
+    if (wifi_link_monitor_start(g_anjay, WIFI_SSID, WIFI_PASSWORD)) {
+        avs_log(main, WARNING, "Wi-Fi link will not be monitored");
+    }
 
-    main_loop();
+    event_loop_run(g_anjay);
+    wifi_link_monitor_stop();
     anjay_delete(g_anjay);
     temperature_sensor_release();
 }
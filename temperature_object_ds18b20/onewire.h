@@ -0,0 +1,100 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 1-Wire bus access. The byte-level helpers and the CRC are shared, while the
+ * transport (reset pulse and time slots) comes from a backend selected at
+ * build time: onewire_gpio.c drives a GPIO pin from a hardware alarm
+ * interrupt on the device and onewire_sim.c simulates DS18B20 sensors in the
+ * host build.
+ */
+
+/* Transport backend */
+
+int onewire_init(unsigned pin);
+void onewire_release(void);
+
+/**
+ * Sends a reset pulse. Returns 0 if at least one device answered with
+ * a presence pulse.
+ */
+int onewire_reset(void);
+
+/**
+ * Generates a single time slot. A 0 is always written as 0; a 1 is a read
+ * slot, so the returned line state is 0 if any device pulled the bus low.
+ */
+bool onewire_touch_bit(bool value);
+
+/**
+ * Generates len * 8 time slots, LSB first, as with onewire_touch_bit(). If tx
+ * is NULL, all slots are read slots. If rx is not NULL, the sampled line state
+ * is stored there. The calling task is blocked, not spinning, for the duration
+ * of the transfer. Returns 0 on success.
+ */
+int onewire_transfer(const uint8_t *tx, uint8_t *rx, size_t len);
+
+/* Shared helpers */
+
+void onewire_write_bit(bool value);
+bool onewire_read_bit(void);
+
+void onewire_write_byte(uint8_t byte);
+uint8_t onewire_read_byte(void);
+
+int onewire_write_bytes(const uint8_t *data, size_t len);
+int onewire_read_bytes(uint8_t *data, size_t len);
+
+#define ONEWIRE_ROM_CODE_SIZE 8
+
+typedef struct {
+    uint8_t rom_code[ONEWIRE_ROM_CODE_SIZE];
+    /* bit position of the last branch where 0 was taken, -1 if none */
+    int last_discrepancy;
+    bool last_device;
+} onewire_search_t;
+
+void onewire_search_init(onewire_search_t *search);
+
+/**
+ * Finds the next device on the bus using the Search ROM algorithm (Maxim
+ * application note 187) and stores its ROM code in search->rom_code.
+ *
+ * Returns 0 if a device was found, 1 if all devices have already been found,
+ * or -1 on a bus or CRC error.
+ */
+int onewire_search_next(onewire_search_t *search);
+
+/* Implementations of onewire_crc8(), selected with ONEWIRE_CRC8_IMPL */
+#define ONEWIRE_CRC8_BITWISE 0 /* no table, 8 iterations per byte */
+#define ONEWIRE_CRC8_NIBBLE 1  /* two 16-byte tables, 2 lookups per byte */
+#define ONEWIRE_CRC8_TABLE 2   /* 256-byte table, 1 lookup per byte */
+
+#ifndef ONEWIRE_CRC8_IMPL
+#    define ONEWIRE_CRC8_IMPL ONEWIRE_CRC8_TABLE
+#endif
+
+/**
+ * Dallas/Maxim CRC-8 (polynomial x^8 + x^5 + x^4 + 1), as used in ROM codes
+ * and DS18B20 scratchpads.
+ */
+uint8_t onewire_crc8(const uint8_t *data, size_t len);
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "onewire.h"
+
+/*
+ * Time slots are generated from a hardware alarm interrupt, so the calling
+ * task sleeps on a semaphore for the duration of a transfer. The parts of a
+ * slot that need microsecond accuracy (the short low pulse of a 1/read slot
+ * and sampling the line) are done within a single interrupt; only the long
+ * phases (write 0 low time, recovery, reset pulse) are timed with the alarm.
+ * All deadlines are relative to the start of the slot, so interrupt latency
+ * does not accumulate.
+ */
+
+/* Reset: low time, presence sampling point and total duration */
+#define RESET_LOW_US 480
+#define RESET_SAMPLE_US (RESET_LOW_US + 70)
+#define RESET_SLOT_US (RESET_SAMPLE_US + 410)
+
+/* Write/read slots */
+#define SLOT_US 70
+#define WRITE_0_LOW_US 60
+#define WRITE_1_LOW_US 6
+#define READ_SAMPLE_DELAY_US 9
+
+/* Delay before the first slot, so that it is started from the interrupt */
+#define START_DELAY_US 2
+
+/* Upper bound of interrupt latency accounted for in transfer timeouts */
+#define TRANSFER_TIMEOUT_MARGIN_MS 10
+
+typedef enum {
+    PHASE_RESET_START,
+    PHASE_RESET_RELEASE,
+    PHASE_RESET_SAMPLE,
+    PHASE_SLOT_START,
+    PHASE_SLOT_RELEASE,
+    PHASE_DONE
+} onewire_phase_t;
+
+typedef struct {
+    onewire_phase_t phase;
+    absolute_time_t slot_start;
+    absolute_time_t target;
+
+    /* bits to send, NULL for read slots only */
+    const uint8_t *tx;
+    /* buffer for the sampled bits, may be NULL */
+    uint8_t *rx;
+    size_t bit_count;
+    size_t bit;
+
+    bool presence;
+} onewire_transfer_t;
+
+static unsigned onewire_pin;
+static int alarm_num = -1;
+static SemaphoreHandle_t transfer_done;
+/* Owned by the alarm interrupt while a transfer is running; the semaphore
+ * orders the accesses from the task and the interrupt */
+static onewire_transfer_t transfer;
+
+static void line_low(void) {
+    gpio_set_dir(onewire_pin, GPIO_OUT);
+}
+
+static void line_release(void) {
+    // the output latch is kept at 0, so the pin is only ever driven low and
+    // the pull-up takes the line high
+    gpio_set_dir(onewire_pin, GPIO_IN);
+}
+
+static bool tx_bit(size_t bit) {
+    return !transfer.tx || ((transfer.tx[bit / 8] >> (bit % 8)) & 1);
+}
+
+static void store_rx_bit(size_t bit, bool value) {
+    if (!transfer.rx) {
+        return;
+    }
+    if (value) {
+        transfer.rx[bit / 8] |= (uint8_t) (1 << (bit % 8));
+    } else {
+        transfer.rx[bit / 8] &= (uint8_t) ~(1 << (bit % 8));
+    }
+}
+
+static void next_slot(void) {
+    transfer.slot_start = delayed_by_us(transfer.slot_start, SLOT_US);
+    transfer.target = transfer.slot_start;
+    transfer.phase = ++transfer.bit < transfer.bit_count ? PHASE_SLOT_START
+                                                         : PHASE_DONE;
+}
+
+/**
+ * Executes the current phase and sets up the next one. Returns false when the
+ * transfer is complete.
+ */
+static bool transfer_step(void) {
+    switch (transfer.phase) {
+    case PHASE_RESET_START:
+        transfer.slot_start = get_absolute_time();
+        line_low();
+        transfer.target = delayed_by_us(transfer.slot_start, RESET_LOW_US);
+        transfer.phase = PHASE_RESET_RELEASE;
+        return true;
+
+    case PHASE_RESET_RELEASE:
+        line_release();
+        transfer.target = delayed_by_us(transfer.slot_start, RESET_SAMPLE_US);
+        transfer.phase = PHASE_RESET_SAMPLE;
+        return true;
+
+    case PHASE_RESET_SAMPLE:
+        transfer.presence = !gpio_get(onewire_pin);
+        transfer.target = delayed_by_us(transfer.slot_start, RESET_SLOT_US);
+        transfer.phase = PHASE_DONE;
+        return true;
+
+    case PHASE_SLOT_START:
+        if (transfer.bit == 0) {
+            transfer.slot_start = get_absolute_time();
+        }
+        line_low();
+        if (tx_bit(transfer.bit)) {
+            busy_wait_us_32(WRITE_1_LOW_US);
+            line_release();
+            busy_wait_us_32(READ_SAMPLE_DELAY_US);
+            store_rx_bit(transfer.bit, gpio_get(onewire_pin));
+            next_slot();
+        } else {
+            store_rx_bit(transfer.bit, false);
+            transfer.target =
+                    delayed_by_us(transfer.slot_start, WRITE_0_LOW_US);
+            transfer.phase = PHASE_SLOT_RELEASE;
+        }
+        return true;
+
+    case PHASE_SLOT_RELEASE:
+        line_release();
+        next_slot();
+        return true;
+
+    case PHASE_DONE:
+    default:
+        return false;
+    }
+}
+
+static void alarm_callback(uint alarm) {
+    // hardware_alarm_set_target() returns true if the target has already
+    // passed; run the next phase right away in that case
+    do {
+        if (!transfer_step()) {
+            BaseType_t woken = pdFALSE;
+            xSemaphoreGiveFromISR(transfer_done, &woken);
+            portYIELD_FROM_ISR(woken);
+            return;
+        }
+    } while (hardware_alarm_set_target(alarm, transfer.target));
+}
+
+static int run_transfer(size_t slot_count) {
+    const TickType_t timeout = pdMS_TO_TICKS(
+            (RESET_SLOT_US + slot_count * SLOT_US) / 1000
+            + TRANSFER_TIMEOUT_MARGIN_MS);
+
+    xSemaphoreTake(transfer_done, 0);
+    if (hardware_alarm_set_target((uint) alarm_num,
+                                  make_timeout_time_us(START_DELAY_US))) {
+        hardware_alarm_force_irq((uint) alarm_num);
+    }
+    if (xSemaphoreTake(transfer_done, timeout) != pdTRUE) {
+        hardware_alarm_cancel((uint) alarm_num);
+        line_release();
+        return -1;
+    }
+    return 0;
+}
+
+int onewire_init(unsigned pin) {
+    onewire_pin = pin;
+    gpio_init(onewire_pin);
+    gpio_pull_up(onewire_pin);
+    gpio_put(onewire_pin, 0);
+
+    if (!transfer_done && !(transfer_done = xSemaphoreCreateBinary())) {
+        return -1;
+    }
+    if (alarm_num < 0
+            && (alarm_num = hardware_alarm_claim_unused(false)) < 0) {
+        return -1;
+    }
+    hardware_alarm_set_callback((uint) alarm_num, alarm_callback);
+    irq_set_priority(TIMER_IRQ_0 + (uint) alarm_num,
+                     PICO_HIGHEST_IRQ_PRIORITY);
+    return 0;
+}
+
+void onewire_release(void) {
+    if (alarm_num >= 0) {
+        hardware_alarm_set_callback((uint) alarm_num, NULL);
+        hardware_alarm_unclaim((uint) alarm_num);
+        alarm_num = -1;
+    }
+    if (transfer_done) {
+        vSemaphoreDelete(transfer_done);
+        transfer_done = NULL;
+    }
+    gpio_deinit(onewire_pin);
+}
+
+int onewire_reset(void) {
+    transfer.phase = PHASE_RESET_START;
+    transfer.presence = false;
+    if (run_transfer(0)) {
+        return -1;
+    }
+    return transfer.presence ? 0 : 1;
+}
+
+static int transfer_bits(const uint8_t *tx, uint8_t *rx, size_t bit_count) {
+    if (!bit_count) {
+        return 0;
+    }
+    transfer.phase = PHASE_SLOT_START;
+    transfer.tx = tx;
+    transfer.rx = rx;
+    transfer.bit_count = bit_count;
+    transfer.bit = 0;
+    return run_transfer(bit_count);
+}
+
+bool onewire_touch_bit(bool value) {
+    const uint8_t tx = value ? 1 : 0;
+    uint8_t rx = 1;
+    transfer_bits(&tx, &rx, 1);
+    return rx & 1;
+}
+
+int onewire_transfer(const uint8_t *tx, uint8_t *rx, size_t len) {
+    return transfer_bits(tx, rx, len * 8);
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "onewire.h"
+#include "onewire_sim.h"
+
+#define DS18B20_FAMILY_CODE 0x28
+
+#define ROM_CODE_SIZE 8
+#define SCRATCHPAD_SIZE 9
+
+#define CMD_READ_ROM 0x33
+#define CMD_MATCH_ROM 0x55
+#define CMD_SKIP_ROM 0xCC
+#define CMD_SEARCH_ROM 0xF0
+#define CMD_CONVERT_T 0x44
+#define CMD_WRITE_SCRATCHPAD 0x4E
+#define CMD_READ_SCRATCHPAD 0xBE
+#define CMD_READ_POWER_SUPPLY 0xB4
+
+#define SCRATCHPAD_TEMP_LSB 0
+#define SCRATCHPAD_TEMP_MSB 1
+#define SCRATCHPAD_TH 2
+#define SCRATCHPAD_TL 3
+#define SCRATCHPAD_CONFIG 4
+#define SCRATCHPAD_CRC 8
+
+#define WRITE_SCRATCHPAD_SIZE 3
+
+/* Power-on value of the temperature register: +85 degrees Celsius */
+#define POWER_ON_TEMP_RAW 0x0550
+
+#define DEFAULT_SERIAL 0x0000DEADBEEFULL
+#define DEFAULT_TEMPERATURE_MC 21500
+
+typedef enum {
+    SIM_IDLE,
+    SIM_ROM_CMD,
+    SIM_MATCH_ROM,
+    SIM_SEARCH_ROM,
+    SIM_FUNC_CMD,
+    SIM_RX,
+    SIM_TX,
+    SIM_STATUS,
+    SIM_POWERED
+} sim_state_t;
+
+typedef struct {
+    uint8_t rom[ROM_CODE_SIZE];
+    uint8_t scratchpad[SCRATCHPAD_SIZE];
+    int32_t temperature_mc;
+    bool present;
+    bool crc_error;
+    bool converting;
+    uint64_t conversion_end_us;
+
+    sim_state_t state;
+    /* bit accumulator for commands and received data */
+    uint8_t rx_byte;
+    size_t rx_bits;
+    /* data being transferred in SIM_RX/SIM_TX, or the ROM bit position in
+     * SIM_MATCH_ROM/SIM_SEARCH_ROM */
+    uint8_t buf[SCRATCHPAD_SIZE];
+    size_t buf_len;
+    size_t bit_pos;
+    /* SIM_SEARCH_ROM: 0 - send bit, 1 - send complement, 2 - read direction */
+    int search_phase;
+} sim_ds18b20_t;
+
+static sim_ds18b20_t devices[ONEWIRE_SIM_MAX_DEVICES];
+static size_t device_count;
+static onewire_sim_stats_t stats;
+
+static bool get_bit(const uint8_t *data, size_t bit) {
+    return (data[bit / 8] >> (bit % 8)) & 1;
+}
+
+static unsigned resolution_bits(const sim_ds18b20_t *dev) {
+    return 9 + ((dev->scratchpad[SCRATCHPAD_CONFIG] >> 5) & 0x03);
+}
+
+static uint64_t conversion_time_us(const sim_ds18b20_t *dev) {
+    return 750000u >> (12 - resolution_bits(dev));
+}
+
+static void update_conversion(sim_ds18b20_t *dev) {
+    if (!dev->converting || time_us_64() < dev->conversion_end_us) {
+        return;
+    }
+    dev->converting = false;
+
+    // round to 1/16 degree, then drop the bits undefined at this resolution
+    int32_t raw = (dev->temperature_mc * 16 + (dev->temperature_mc >= 0
+                                                       ? 500
+                                                       : -500))
+                  / 1000;
+    raw &= ~((1 << (12 - resolution_bits(dev))) - 1);
+    dev->scratchpad[SCRATCHPAD_TEMP_LSB] = (uint8_t) (raw & 0xFF);
+    dev->scratchpad[SCRATCHPAD_TEMP_MSB] = (uint8_t) ((raw >> 8) & 0xFF);
+}
+
+static void start_tx(sim_ds18b20_t *dev, const uint8_t *data, size_t len) {
+    memcpy(dev->buf, data, len);
+    dev->buf_len = len;
+    dev->bit_pos = 0;
+    dev->state = SIM_TX;
+}
+
+static void handle_rom_cmd(sim_ds18b20_t *dev, uint8_t cmd) {
+    switch (cmd) {
+    case CMD_READ_ROM:
+        start_tx(dev, dev->rom, ROM_CODE_SIZE);
+        break;
+    case CMD_SKIP_ROM:
+        dev->state = SIM_FUNC_CMD;
+        break;
+    case CMD_MATCH_ROM:
+        dev->bit_pos = 0;
+        dev->state = SIM_MATCH_ROM;
+        break;
+    case CMD_SEARCH_ROM:
+        dev->bit_pos = 0;
+        dev->search_phase = 0;
+        dev->state = SIM_SEARCH_ROM;
+        break;
+    default:
+        dev->state = SIM_IDLE;
+        break;
+    }
+}
+
+static void handle_func_cmd(sim_ds18b20_t *dev, uint8_t cmd) {
+    switch (cmd) {
+    case CMD_CONVERT_T:
+        ++stats.conversions;
+        dev->converting = true;
+        dev->conversion_end_us = time_us_64() + conversion_time_us(dev);
+        dev->state = SIM_STATUS;
+        break;
+    case CMD_READ_SCRATCHPAD:
+        ++stats.scratchpad_reads;
+        dev->scratchpad[SCRATCHPAD_CRC] =
+                onewire_crc8(dev->scratchpad, SCRATCHPAD_SIZE - 1);
+        start_tx(dev, dev->scratchpad, SCRATCHPAD_SIZE);
+        if (dev->crc_error) {
+            dev->buf[SCRATCHPAD_CRC] ^= 0x01;
+        }
+        break;
+    case CMD_WRITE_SCRATCHPAD:
+        dev->buf_len = 0;
+        dev->state = SIM_RX;
+        break;
+    case CMD_READ_POWER_SUPPLY:
+        dev->state = SIM_POWERED;
+        break;
+    default:
+        dev->state = SIM_IDLE;
+        break;
+    }
+}
+
+static void handle_rx_byte(sim_ds18b20_t *dev, uint8_t byte) {
+    dev->buf[dev->buf_len++] = byte;
+    if (dev->buf_len == WRITE_SCRATCHPAD_SIZE) {
+        dev->scratchpad[SCRATCHPAD_TH] = dev->buf[0];
+        dev->scratchpad[SCRATCHPAD_TL] = dev->buf[1];
+        // only R1 and R0 are writable, the remaining bits always read as 1
+        dev->scratchpad[SCRATCHPAD_CONFIG] = (dev->buf[2] & 0x60) | 0x1F;
+        dev->state = SIM_IDLE;
+    }
+}
+
+static void device_write_bit(sim_ds18b20_t *dev, bool value) {
+    switch (dev->state) {
+    case SIM_ROM_CMD:
+    case SIM_FUNC_CMD:
+    case SIM_RX:
+        dev->rx_byte = (uint8_t) ((dev->rx_byte >> 1) | (value ? 0x80 : 0));
+        if (++dev->rx_bits == 8) {
+            const uint8_t byte = dev->rx_byte;
+            dev->rx_bits = 0;
+            if (dev->state == SIM_ROM_CMD) {
+                handle_rom_cmd(dev, byte);
+            } else if (dev->state == SIM_FUNC_CMD) {
+                handle_func_cmd(dev, byte);
+            } else {
+                handle_rx_byte(dev, byte);
+            }
+        }
+        break;
+    case SIM_MATCH_ROM:
+        if (value != get_bit(dev->rom, dev->bit_pos)) {
+            dev->state = SIM_IDLE;
+        } else if (++dev->bit_pos == ROM_CODE_SIZE * 8) {
+            dev->state = SIM_FUNC_CMD;
+        }
+        break;
+    case SIM_SEARCH_ROM:
+        if (dev->search_phase != 2) {
+            break;
+        }
+        if (value != get_bit(dev->rom, dev->bit_pos)) {
+            dev->state = SIM_IDLE;
+        } else if (++dev->bit_pos == ROM_CODE_SIZE * 8) {
+            dev->state = SIM_FUNC_CMD;
+        } else {
+            dev->search_phase = 0;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static bool device_read_bit(sim_ds18b20_t *dev) {
+    switch (dev->state) {
+    case SIM_TX: {
+        const bool value = get_bit(dev->buf, dev->bit_pos);
+        if (++dev->bit_pos == dev->buf_len * 8) {
+            dev->state = SIM_IDLE;
+        }
+        return value;
+    }
+    case SIM_SEARCH_ROM:
+        if (dev->search_phase == 0) {
+            dev->search_phase = 1;
+            return get_bit(dev->rom, dev->bit_pos);
+        } else if (dev->search_phase == 1) {
+            dev->search_phase = 2;
+            return !get_bit(dev->rom, dev->bit_pos);
+        }
+        return true;
+    case SIM_STATUS:
+        return !dev->converting;
+    default:
+        // not driving the bus, the pull-up keeps it high
+        return true;
+    }
+}
+
+static bool device_is_transmitting(const sim_ds18b20_t *dev) {
+    switch (dev->state) {
+    case SIM_TX:
+    case SIM_STATUS:
+    case SIM_POWERED:
+        return true;
+    case SIM_SEARCH_ROM:
+        return dev->search_phase != 2;
+    default:
+        return false;
+    }
+}
+
+/**
+ * A read slot and a write 1 slot look the same on the wire, the device state
+ * decides which one it is.
+ */
+static bool device_slot(sim_ds18b20_t *dev, bool value) {
+    if (device_is_transmitting(dev)) {
+        return device_read_bit(dev);
+    }
+    device_write_bit(dev, value);
+    return true;
+}
+
+int onewire_sim_add_ds18b20(uint64_t serial, int32_t temperature_mc) {
+    if (device_count >= ONEWIRE_SIM_MAX_DEVICES) {
+        return -1;
+    }
+    sim_ds18b20_t *dev = &devices[device_count];
+    memset(dev, 0, sizeof(*dev));
+    dev->rom[0] = DS18B20_FAMILY_CODE;
+    for (size_t i = 1; i < ROM_CODE_SIZE - 1; i++) {
+        dev->rom[i] = (uint8_t) (serial >> (8 * (i - 1)));
+    }
+    dev->rom[ROM_CODE_SIZE - 1] = onewire_crc8(dev->rom, ROM_CODE_SIZE - 1);
+
+    dev->scratchpad[SCRATCHPAD_TEMP_LSB] = POWER_ON_TEMP_RAW & 0xFF;
+    dev->scratchpad[SCRATCHPAD_TEMP_MSB] = POWER_ON_TEMP_RAW >> 8;
+    dev->scratchpad[SCRATCHPAD_TH] = 0x4B;
+    dev->scratchpad[SCRATCHPAD_TL] = 0x46;
+    dev->scratchpad[SCRATCHPAD_CONFIG] = 0x7F;
+    dev->scratchpad[5] = 0xFF;
+    dev->scratchpad[6] = 0x0C;
+    dev->scratchpad[7] = 0x10;
+    dev->temperature_mc = temperature_mc;
+    dev->present = true;
+    dev->state = SIM_IDLE;
+
+    return (int) device_count++;
+}
+
+void onewire_sim_set_temperature(size_t index, int32_t temperature_mc) {
+    if (index < device_count) {
+        devices[index].temperature_mc = temperature_mc;
+    }
+}
+
+void onewire_sim_set_present(size_t index, bool present) {
+    if (index < device_count) {
+        devices[index].present = present;
+        devices[index].state = SIM_IDLE;
+    }
+}
+
+void onewire_sim_set_crc_error(size_t index, bool crc_error) {
+    if (index < device_count) {
+        devices[index].crc_error = crc_error;
+    }
+}
+
+void onewire_sim_get_stats(onewire_sim_stats_t *out_stats) {
+    *out_stats = stats;
+}
+
+void onewire_sim_clear(void) {
+    device_count = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+int onewire_init(unsigned pin) {
+    (void) pin;
+    if (!device_count) {
+        onewire_sim_add_ds18b20(DEFAULT_SERIAL, DEFAULT_TEMPERATURE_MC);
+    }
+    return 0;
+}
+
+void onewire_release(void) {
+}
+
+int onewire_reset(void) {
+    ++stats.resets;
+    bool presence = false;
+    for (size_t i = 0; i < device_count; i++) {
+        update_conversion(&devices[i]);
+        if (devices[i].present) {
+            devices[i].state = SIM_ROM_CMD;
+            devices[i].rx_bits = 0;
+            presence = true;
+        }
+    }
+    return presence ? 0 : 1;
+}
+
+bool onewire_touch_bit(bool value) {
+    // open-drain bus: any device driving a zero wins
+    ++stats.slots;
+    bool line = value;
+    for (size_t i = 0; i < device_count; i++) {
+        update_conversion(&devices[i]);
+        if (devices[i].present) {
+            line &= device_slot(&devices[i], value);
+        }
+    }
+    return line;
+}
+
+int onewire_transfer(const uint8_t *tx, uint8_t *rx, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t in = 0;
+        for (size_t bit = 0; bit < 8; bit++) {
+            const bool value = !tx || ((tx[i] >> bit) & 1);
+            if (onewire_touch_bit(value)) {
+                in |= (uint8_t) (1 << bit);
+            }
+        }
+        if (rx) {
+            rx[i] = in;
+        }
+    }
+    return 0;
+}
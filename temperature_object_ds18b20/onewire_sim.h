@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Simulated 1-Wire bus with DS18B20 sensors, used as the onewire.h backend in
+ * the host build. The simulation works at the bit level, so the ROM commands,
+ * the conversion busy status and CRCs are exercised the same way as on real
+ * hardware.
+ *
+ * If no sensor is added before onewire_init(), a single default sensor is
+ * created so that the example runs out of the box.
+ */
+
+#define ONEWIRE_SIM_MAX_DEVICES 16
+
+typedef struct {
+    /* Reset pulses and time slots generated by the master */
+    uint32_t resets;
+    uint32_t slots;
+    /* Function commands decoded, summed over all sensors, so a broadcast
+     * Convert T counts once for every sensor on the bus */
+    uint32_t conversions;
+    uint32_t scratchpad_reads;
+} onewire_sim_stats_t;
+
+/**
+ * Adds a DS18B20 with the given 48-bit serial number and initial temperature
+ * in millidegrees Celsius. Returns the index of the sensor or -1 if the bus is
+ * full.
+ */
+int onewire_sim_add_ds18b20(uint64_t serial, int32_t temperature_mc);
+
+/**
+ * Sets the temperature that the next conversion on the given sensor reports.
+ */
+void onewire_sim_set_temperature(size_t index, int32_t temperature_mc);
+
+/**
+ * Disconnects the given sensor from the bus, or connects it back. A
+ * disconnected sensor neither answers reset pulses nor drives the bus, but
+ * keeps its state.
+ */
+void onewire_sim_set_present(size_t index, bool present);
+
+/**
+ * Makes the given sensor send its scratchpad with an invalid CRC, as if it
+ * had been corrupted on the wire.
+ */
+void onewire_sim_set_crc_error(size_t index, bool crc_error);
+
+void onewire_sim_get_stats(onewire_sim_stats_t *out_stats);
+
+/**
+ * Removes all simulated sensors and clears the statistics.
+ */
+void onewire_sim_clear(void);
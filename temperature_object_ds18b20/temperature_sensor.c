@@ -24,21 +24,105 @@
 #include <avsystem/commons/avs_log.h>
 
 #include "ds18b20.h"
+#include "ds18b20_config_object.h"
+#include "sensor_change_filter.h"
+#include "sensor_history.h"
+#include "sensor_sample.h"
+#include "sensor_sampling.h"
+#include "sensor_stats_object.h"
 #include "temperature_sensor.h"
 
+#define SENSOR_VALUE_RID 5700
+
+/* Changes smaller than this, in millidegrees Celsius, are treated as noise */
+#ifndef TEMPERATURE_SENSOR_DEADBAND_MC
+#    define TEMPERATURE_SENSOR_DEADBAND_MC 125
+#endif
+
+/* Number of samples uploaded in a single LwM2M Send message, 0 to disable */
+#ifndef TEMPERATURE_SENSOR_HISTORY_SIZE
+#    define TEMPERATURE_SENSOR_HISTORY_SIZE 100
+#endif
+
+/* Keep samples that could not be sent in flash, see sensor_flash_log.h */
+#ifndef TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+#    define TEMPERATURE_SENSOR_FLASH_LOG_ENABLED 1
+#endif
+
+/* Maximum time a sample waits in the history before it is sent */
+#ifndef TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS
+#    define TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS 300000
+#endif
+
+/* Sampling period while Sensor Value is not observed, 0 to stop sampling */
+#ifndef TEMPERATURE_SENSOR_IDLE_PERIOD_MS
+#    if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+#        define TEMPERATURE_SENSOR_IDLE_PERIOD_MS 10000
+#    else
+#        define TEMPERATURE_SENSOR_IDLE_PERIOD_MS 0
+#    endif
+#endif
+
+#define SERVER_SSID 1
+
+static const anjay_dm_object_def_t **CONFIG_OBJ;
+static const anjay_dm_object_def_t **STATS_OBJ;
+static sensor_change_filter_t change_filters[DS18B20_MAX_SENSORS];
+static sensor_sampling_t sampling;
+
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+static sensor_history_entry_t history_entries[TEMPERATURE_SENSOR_HISTORY_SIZE];
+static sensor_history_t history;
+#    if TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+static sensor_flash_log_t flash_log;
+#    endif // TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+
 static int
 temperature_sensor_get_value(anjay_iid_t iid, void *_ctx, double *value) {
-    (void) iid;
     (void) _ctx;
     assert(value);
 
-    double read_value;
-    if (!temperature_read_data() && !temperature_get_data(&read_value)) {
-        *value = read_value;
-        return 0;
-    } else {
+    // only returns the latest sample taken by the sampling job; if sampling
+    // has stopped because nobody observed the value, resume it
+    sensor_sampling_kick(&sampling);
+    int32_t millicelsius;
+    if (temperature_get_data(iid, &millicelsius)) {
         return -1;
     }
+    *value = sensor_sample_to_double(millicelsius);
+    return 0;
+}
+
+static int32_t sample_temperature(anjay_t *anjay) {
+    const int result = ds18b20_process();
+    if (result == 0) {
+        // conversion still in progress, check again in a while
+        return (int32_t) ds18b20_get_conversion_time_ms() / 4 + 1;
+    }
+    if (result < 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < ds18b20_get_sensor_count(); i++) {
+        int32_t value;
+        if (temperature_get_data(i, &value)) {
+            continue;
+        }
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+        sensor_history_add(&history, (anjay_iid_t) i, value);
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+        sensor_stats_object_add_sample(anjay, STATS_OBJ, (anjay_iid_t) i,
+                                       value);
+
+        // pass the sample to Anjay only if it may trigger a notification
+        if (sensor_change_filter_check_resource(&change_filters[i], anjay, 3303,
+                                                (anjay_iid_t) i,
+                                                SENSOR_VALUE_RID, value)) {
+            anjay_ipso_basic_sensor_update(anjay, 3303, (anjay_iid_t) i);
+        }
+    }
+    return 0;
 }
 
 void temperature_sensor_install(anjay_t *anjay) {
@@ -49,33 +133,101 @@ void temperature_sensor_install(anjay_t *anjay) {
         return;
     }
 
-    if (anjay_ipso_basic_sensor_install(anjay, 3303, 1)) {
+    const size_t sensor_count = ds18b20_get_sensor_count();
+    if (anjay_ipso_basic_sensor_install(anjay, 3303, sensor_count)) {
         avs_log(ipso_object,
                 WARNING,
                 "Object: Temperature sensor could not be installed");
         return;
     }
 
-    if (anjay_ipso_basic_sensor_instance_add(
-                anjay,
-                3303,
-                0,
-                (anjay_ipso_basic_sensor_impl_t) {
-                    .unit = "Cel",
-                    .min_range_value = NAN,
-                    .max_range_value = NAN,
-                    .get_value = temperature_sensor_get_value
-                })) {
+    // one instance per sensor found on the bus, in discovery order
+    for (size_t i = 0; i < sensor_count; i++) {
+        sensor_change_filter_init(&change_filters[i],
+                                  TEMPERATURE_SENSOR_DEADBAND_MC);
+
+        const uint8_t *rom = ds18b20_get_rom_code(i);
+        avs_log(ipso_object, INFO,
+                "DS18B20 %02X%02X%02X%02X%02X%02X%02X%02X as /3303/%u", rom[0],
+                rom[1], rom[2], rom[3], rom[4], rom[5], rom[6], rom[7],
+                (unsigned) i);
+
+        if (anjay_ipso_basic_sensor_instance_add(
+                    anjay,
+                    3303,
+                    (anjay_iid_t) i,
+                    (anjay_ipso_basic_sensor_impl_t) {
+                        .unit = "Cel",
+                        .min_range_value = NAN,
+                        .max_range_value = NAN,
+                        .get_value = temperature_sensor_get_value
+                    })) {
+            avs_log(ipso_object,
+                    WARNING,
+                    "Instance of Temperature sensor object could not be added");
+        }
+    }
+
+    CONFIG_OBJ = ds18b20_config_object_create();
+    if (!CONFIG_OBJ || anjay_register_object(anjay, CONFIG_OBJ)) {
         avs_log(ipso_object,
                 WARNING,
-                "Instance of Temperature sensor object could not be added");
+                "Object: DS18B20 Configuration could not be installed");
+        ds18b20_config_object_release(CONFIG_OBJ);
+        CONFIG_OBJ = NULL;
     }
-}
 
-void temperature_sensor_update(anjay_t *anjay) {
-    anjay_ipso_basic_sensor_update(anjay, 3303, 0);
+    STATS_OBJ = sensor_stats_object_create((anjay_iid_t) sensor_count);
+    if (!STATS_OBJ || anjay_register_object(anjay, STATS_OBJ)) {
+        avs_log(ipso_object,
+                WARNING,
+                "Object: Sensor Statistics could not be installed");
+        sensor_stats_object_release(STATS_OBJ);
+        STATS_OBJ = NULL;
+    }
+
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    history = (sensor_history_t) {
+        .anjay = anjay,
+        .ssid = SERVER_SSID,
+        .oid = 3303,
+        .rid = SENSOR_VALUE_RID,
+        .flush_interval_ms = TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS,
+        .entries = history_entries,
+        .capacity = TEMPERATURE_SENSOR_HISTORY_SIZE
+    };
+#    if TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+    if (sensor_flash_log_open(&flash_log, SENSOR_FLASH_LOG_OFFSET,
+                              SENSOR_FLASH_LOG_SIZE)) {
+        avs_log(ipso_object, WARNING,
+                "Flash log could not be opened, samples will not be stored");
+    } else {
+        history.log = &flash_log;
+    }
+#    endif // TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+    sensor_history_init(&history);
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+
+    sampling = (sensor_sampling_t) {
+        .anjay = anjay,
+        .oid = 3303,
+        .instance_count = (anjay_iid_t) sensor_count,
+        .rid = SENSOR_VALUE_RID,
+        .idle_period_ms = TEMPERATURE_SENSOR_IDLE_PERIOD_MS,
+        .sample = sample_temperature
+    };
+    sensor_sampling_start(&sampling);
 }
 
 void temperature_sensor_release(void) {
+    sensor_sampling_stop(&sampling);
+    sampling.anjay = NULL;
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    sensor_history_cleanup(&history);
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    ds18b20_config_object_release(CONFIG_OBJ);
+    CONFIG_OBJ = NULL;
+    sensor_stats_object_release(STATS_OBJ);
+    STATS_OBJ = NULL;
     ds18b20_release();
 }
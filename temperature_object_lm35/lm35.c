@@ -18,22 +18,141 @@
 #include <hardware/gpio.h>
 #include <pico/stdlib.h>
 
+#include <avsystem/commons/avs_defs.h>
+
 #include "lm35.h"
+#include "lm35_adc.h"
+#include "sensor_filter.h"
+#include "sensor_sample.h"
 
 #if (LM35_GPIO_PIN < 26) || (LM35_GPIO_PIN > 28)
 #    error "Invalid ADC GPIO pin selected for LM35 sensor"
 #endif
 
+#if (LM35_OVERSAMPLE < 1) || (LM35_OVERSAMPLE > LM35_ADC_MAX_FETCH)
+#    error "Invalid LM35_OVERSAMPLE value"
+#endif
+
+/* 12-bit ADC with a 3.3 V reference; the LM35 outputs 10 mV per degree */
+#define ADC_VREF_MV 3300
+#define ADC_RANGE 4096
+#define LM35_MV_PER_DEGREE 10
+
+/* Millidegrees per full ADC range, divided by the scale of the filtered
+ * value, so that the conversion fits in 32 bits */
+#define MILLICELSIUS_PER_FILTERED_RANGE                \
+    ((ADC_VREF_MV * 1000 / LM35_MV_PER_DEGREE)         \
+     >> SENSOR_FILTER_FRACTION_BITS)
+
+AVS_STATIC_ASSERT((MILLICELSIUS_PER_FILTERED_RANGE
+                   << SENSOR_FILTER_FRACTION_BITS)
+                          == ADC_VREF_MV * 1000 / LM35_MV_PER_DEGREE,
+                  exact_conversion);
+
+/* On-die sensor: 706 mV at 27 degrees, falling by 1.721 mV per degree */
+#define DIE_ADC_CHANNEL 4
+#define DIE_REF_MILLICELSIUS 27000
+#define DIE_REF_MICROVOLTS 706000
+#define DIE_MICROVOLTS_PER_DEGREE 1721
+
+#define FILTERED_RANGE ((int64_t) ADC_RANGE << SENSOR_FILTER_FRACTION_BITS)
+
+static const uint SOURCE_ADC_CHANNEL[TEMPERATURE_SOURCE_COUNT] = {
+    [TEMPERATURE_SOURCE_LM35] = LM35_ADC_CHANNEL,
+#if LM35_DIE_TEMPERATURE_ENABLED
+    [TEMPERATURE_SOURCE_DIE] = DIE_ADC_CHANNEL
+#endif // LM35_DIE_TEMPERATURE_ENABLED
+};
+
+AVS_STATIC_ASSERT(TEMPERATURE_SOURCE_COUNT <= LM35_ADC_MAX_CHANNELS,
+                  source_count);
+AVS_STATIC_ASSERT(LM35_ADC_SAMPLE_RATE_HZ * TEMPERATURE_SOURCE_COUNT
+                                  >= LM35_ADC_MIN_TOTAL_RATE_HZ
+                          && LM35_ADC_SAMPLE_RATE_HZ * TEMPERATURE_SOURCE_COUNT
+                                     <= LM35_ADC_MAX_TOTAL_RATE_HZ,
+                  sample_rate);
+
+static sensor_sample_store_t temperature_samples[TEMPERATURE_SOURCE_COUNT];
+
+static int32_t lm35_to_millicelsius(uint32_t filtered) {
+    // rounded to nearest; the product fits in 32 bits for any 12-bit reading
+    return (int32_t) ((filtered * MILLICELSIUS_PER_FILTERED_RANGE
+                       + ADC_RANGE / 2)
+                      / ADC_RANGE);
+}
+
+#if LM35_DIE_TEMPERATURE_ENABLED
+static int32_t die_to_millicelsius(uint32_t filtered) {
+    // computed in 64 bits, as the sensitivity is not a round number; this
+    // runs once per sample, not per conversion
+    const int64_t microvolts =
+            ((int64_t) filtered * ADC_VREF_MV * 1000 + FILTERED_RANGE / 2)
+            / FILTERED_RANGE;
+    return (int32_t) (DIE_REF_MILLICELSIUS
+                      - (microvolts - DIE_REF_MICROVOLTS) * 1000
+                                / DIE_MICROVOLTS_PER_DEGREE);
+}
+#endif // LM35_DIE_TEMPERATURE_ENABLED
+
 int lm35_init(void) {
     adc_init();
     adc_gpio_init(LM35_GPIO_PIN);
+#if LM35_DIE_TEMPERATURE_ENABLED
+    adc_set_temp_sensor_enabled(true);
+#endif // LM35_DIE_TEMPERATURE_ENABLED
+
+    uint channel_mask = 0;
+    for (size_t i = 0; i < TEMPERATURE_SOURCE_COUNT; i++) {
+        sensor_sample_store_init(&temperature_samples[i]);
+        channel_mask |= 1u << SOURCE_ADC_CHANNEL[i];
+    }
+    if (lm35_adc_init(channel_mask, LM35_ADC_SAMPLE_RATE_HZ)) {
+        return -1;
+    }
+    sleep_us((uint64_t) LM35_OVERSAMPLE * 1000000 / LM35_ADC_SAMPLE_RATE_HZ
+             + 1000);
     return 0;
 }
 
-int temperature_get_data(double *sensor_data) {
-    adc_select_input(LM35_ADC_CHANNEL);
-    uint adc_val = adc_read();
-    double milli_volts = (double) adc_val * (3300. / 4096.);
-    *sensor_data = milli_volts / 10.;
-    return 0;
+void lm35_release(void) {
+    lm35_adc_release();
+#if LM35_DIE_TEMPERATURE_ENABLED
+    adc_set_temp_sensor_enabled(false);
+#endif // LM35_DIE_TEMPERATURE_ENABLED
+    gpio_deinit(LM35_GPIO_PIN);
+}
+
+int temperature_read_data(void) {
+    int result = 0;
+    for (size_t i = 0; i < TEMPERATURE_SOURCE_COUNT; i++) {
+        uint16_t samples[LM35_OVERSAMPLE];
+        const size_t count = lm35_adc_get_latest(SOURCE_ADC_CHANNEL[i],
+                                                 samples, LM35_OVERSAMPLE);
+        if (!count) {
+            sensor_sample_store_put_error(&temperature_samples[i]);
+            result = -1;
+            continue;
+        }
+
+        const uint32_t filtered =
+                sensor_filter_apply(LM35_FILTER, samples, count);
+#if LM35_DIE_TEMPERATURE_ENABLED
+        if (i == TEMPERATURE_SOURCE_DIE) {
+            sensor_sample_store_put(&temperature_samples[i],
+                                    die_to_millicelsius(filtered));
+            continue;
+        }
+#endif // LM35_DIE_TEMPERATURE_ENABLED
+        sensor_sample_store_put(&temperature_samples[i],
+                                lm35_to_millicelsius(filtered));
+    }
+    return result;
+}
+
+int temperature_get_data(size_t source, int32_t *out_millicelsius) {
+    if (source >= TEMPERATURE_SOURCE_COUNT) {
+        return -1;
+    }
+    return sensor_sample_store_get_value(&temperature_samples[source],
+                                         out_millicelsius);
 }
@@ -16,11 +16,64 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define ADC_PIN_TO_CHANNEL(Pin) ((Pin) - (26))
 
 /* Temperature sensor ADC channel and pin */
 #define LM35_GPIO_PIN 26
 #define LM35_ADC_CHANNEL ADC_PIN_TO_CHANNEL(LM35_GPIO_PIN)
 
+/* Also acquire the RP2040 on-die temperature sensor, ADC input 4, in the same
+ * round-robin pass as the LM35 */
+#ifndef LM35_DIE_TEMPERATURE_ENABLED
+#    define LM35_DIE_TEMPERATURE_ENABLED 1
+#endif
+
+/* Temperature sources, in the order of the Temperature object instances */
+#define TEMPERATURE_SOURCE_LM35 0
+#define TEMPERATURE_SOURCE_DIE 1
+#if LM35_DIE_TEMPERATURE_ENABLED
+#    define TEMPERATURE_SOURCE_COUNT 2
+#else
+#    define TEMPERATURE_SOURCE_COUNT 1
+#endif
+
+/* ADC sample rate of the continuous acquisition, per source; times
+ * TEMPERATURE_SOURCE_COUNT, it must be within the range the ADC clock divider
+ * supports, see LM35_ADC_MIN_TOTAL_RATE_HZ */
+#ifndef LM35_ADC_SAMPLE_RATE_HZ
+#    define LM35_ADC_SAMPLE_RATE_HZ 1000
+#endif
+
+/* Number of most recent ADC samples reduced to one temperature sample, at
+ * most LM35_ADC_MAX_FETCH */
+#ifndef LM35_OVERSAMPLE
+#    define LM35_OVERSAMPLE 16
+#endif
+
+/* SENSOR_FILTER_AVERAGE for higher resolution or SENSOR_FILTER_MEDIAN to
+ * reject spikes */
+#ifndef LM35_FILTER
+#    define LM35_FILTER SENSOR_FILTER_AVERAGE
+#endif
+
+/**
+ * Starts continuous acquisition and waits until the first LM35_OVERSAMPLE
+ * samples are available.
+ */
 int lm35_init(void);
-int temperature_get_data(double *sensor_data);
+void lm35_release(void);
+
+/**
+ * Filters the most recent ADC samples of every source and stores the results
+ * for temperature_get_data(). Does not wait for the ADC.
+ */
+int temperature_read_data(void);
+
+/**
+ * Returns the latest stored sample of the given source, in millidegrees
+ * Celsius, without accessing the ADC.
+ */
+int temperature_get_data(size_t source, int32_t *out_millicelsius);
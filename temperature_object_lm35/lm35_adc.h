@@ -0,0 +1,58 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico.h"
+
+/**
+ * Continuous ADC acquisition of up to LM35_ADC_MAX_CHANNELS channels, which
+ * are converted in round-robin order. The backend is selected at build time:
+ * lm35_adc_dma.c runs the ADC free-running into a DMA ring buffer on the
+ * device, so taking a sample costs no CPU time, and lm35_adc_host.c reads the
+ * host ADC stand-in, which may replay a recorded trace.
+ */
+
+/* Maximum number of samples that can be fetched at once */
+#define LM35_ADC_MAX_FETCH 128
+
+/* Maximum number of channels acquired at the same time */
+#define LM35_ADC_MAX_CHANNELS 2
+
+/* Supported range of the sample rate times the number of channels. The 48 MHz
+ * ADC clock is divided by at most 65536, and a conversion takes 96 cycles. */
+#define LM35_ADC_MIN_TOTAL_RATE_HZ 733
+#define LM35_ADC_MAX_TOTAL_RATE_HZ 500000
+
+/**
+ * Starts the acquisition of the channels set in channel_mask (bit N for ADC
+ * input N), each at sample_rate_hz. sample_rate_hz times the number of
+ * channels must be between LM35_ADC_MIN_TOTAL_RATE_HZ and
+ * LM35_ADC_MAX_TOTAL_RATE_HZ.
+ */
+int lm35_adc_init(uint channel_mask, uint32_t sample_rate_hz);
+void lm35_adc_release(void);
+
+/**
+ * Copies up to count (at most LM35_ADC_MAX_FETCH) most recent raw 12-bit
+ * samples of the given channel to out, oldest first. Returns the number of
+ * samples copied, which is lower if fewer have been taken since
+ * initialization, and 0 if the channel is not acquired.
+ */
+size_t lm35_adc_get_latest(uint channel, uint16_t *out, size_t count);
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include <hardware/adc.h>
+#include <hardware/dma.h>
+#include <pico/stdlib.h>
+
+#include <avsystem/commons/avs_defs.h>
+
+#include "lm35_adc.h"
+
+/* ADC clock, divided to get the sample rate; a conversion takes 96 cycles */
+#define ADC_CLOCK_HZ 48000000
+#define ADC_CONVERSION_CYCLES 96
+
+/* Largest integer part of the clock divider, a 16-bit field of the DIV
+ * register; adc_set_clkdiv() silently truncates larger values */
+#define ADC_CLKDIV_INT_MAX 65535
+
+AVS_STATIC_ASSERT(ADC_CLOCK_HZ / LM35_ADC_MIN_TOTAL_RATE_HZ - 1
+                          <= ADC_CLKDIV_INT_MAX,
+                  min_total_rate);
+AVS_STATIC_ASSERT(LM35_ADC_MAX_TOTAL_RATE_HZ
+                          <= ADC_CLOCK_HZ / ADC_CONVERSION_CYCLES,
+                  max_total_rate);
+
+/* ADC inputs 0-3 are GPIOs 26-29, input 4 is the internal temperature sensor */
+#define ADC_INPUT_COUNT 5
+
+/* The ring holds twice the largest fetch of every channel, so that the samples
+ * being copied are not overwritten by DMA in the meantime. */
+#define RING_SIZE_BITS 10
+#define RING_SIZE_BYTES (1u << RING_SIZE_BITS)
+#define RING_LENGTH (RING_SIZE_BYTES / sizeof(uint16_t))
+
+AVS_STATIC_ASSERT(RING_LENGTH >= 2 * LM35_ADC_MAX_FETCH * LM35_ADC_MAX_CHANNELS,
+                  ring_size);
+
+/* DMA ring wrapping requires natural alignment */
+static uint16_t ring[RING_LENGTH] __attribute__((aligned(RING_SIZE_BYTES)));
+static int dma_channel = -1;
+static dma_channel_config dma_config;
+
+/* Position of every acquired input in the round-robin sequence, which goes
+ * through the inputs in ascending order */
+static uint first_channel;
+static uint channel_count;
+static int8_t channel_position[ADC_INPUT_COUNT];
+
+static void start_transfer(void) {
+    // the round-robin sequence starts from the selected input, so that sample
+    // N in the ring comes from the input at position N % channel_count
+    adc_select_input(first_channel);
+    // the transfer count only limits the time until a restart, see
+    // lm35_adc_get_latest()
+    dma_channel_configure((uint) dma_channel, &dma_config, ring,
+                          &adc_hw->fifo, UINT32_MAX, true);
+}
+
+int lm35_adc_init(uint channel_mask, uint32_t sample_rate_hz) {
+    assert(channel_mask && channel_mask < (1u << ADC_INPUT_COUNT));
+
+    channel_count = 0;
+    for (uint i = 0; i < ADC_INPUT_COUNT; i++) {
+        channel_position[i] = -1;
+        if (channel_mask & (1u << i)) {
+            if (!channel_count) {
+                first_channel = i;
+            }
+            channel_position[i] = (int8_t) channel_count++;
+        }
+    }
+    assert(channel_count <= LM35_ADC_MAX_CHANNELS);
+    assert(sample_rate_hz * channel_count >= LM35_ADC_MIN_TOTAL_RATE_HZ
+           && sample_rate_hz * channel_count <= LM35_ADC_MAX_TOTAL_RATE_HZ);
+
+    dma_channel = dma_claim_unused_channel(false);
+    if (dma_channel < 0) {
+        return -1;
+    }
+
+    adc_set_round_robin(channel_count > 1 ? channel_mask : 0);
+    adc_fifo_setup(true,   // write conversions to the FIFO
+                   true,   // request DMA for every sample
+                   1,      // DREQ threshold
+                   false,  // no error bit, values stay 12-bit
+                   false); // no byte shift
+    adc_set_clkdiv(
+            (float) (ADC_CLOCK_HZ / (sample_rate_hz * channel_count) - 1));
+
+    dma_config = dma_channel_get_default_config((uint) dma_channel);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, true);
+    channel_config_set_ring(&dma_config, true, RING_SIZE_BITS);
+    channel_config_set_dreq(&dma_config, DREQ_ADC);
+
+    start_transfer();
+    adc_run(true);
+    return 0;
+}
+
+void lm35_adc_release(void) {
+    if (dma_channel < 0) {
+        return;
+    }
+    adc_run(false);
+    dma_channel_abort((uint) dma_channel);
+    dma_channel_unclaim((uint) dma_channel);
+    dma_channel = -1;
+    adc_fifo_drain();
+    adc_fifo_setup(false, false, 0, false, false);
+    adc_set_round_robin(0);
+}
+
+size_t lm35_adc_get_latest(uint channel, uint16_t *out, size_t count) {
+    assert(out);
+    assert(count <= LM35_ADC_MAX_FETCH);
+
+    if (dma_channel < 0 || channel >= ADC_INPUT_COUNT
+            || channel_position[channel] < 0) {
+        return 0;
+    }
+    if (!dma_channel_is_busy((uint) dma_channel)) {
+        // UINT32_MAX transfers have completed, which takes about 2.4 hours at
+        // LM35_ADC_MAX_TOTAL_RATE_HZ (and 68 days at the minimum rate); start
+        // over with an empty ring, so that only this one call finds no samples
+        adc_run(false);
+        adc_fifo_drain();
+        start_transfer();
+        adc_run(true);
+        return 0;
+    }
+
+    // the ring always starts at the beginning of the buffer and its length
+    // divides 2^32, so the sample count alone gives the write position
+    const uint32_t taken =
+            UINT32_MAX
+            - dma_channel_hw_addr((uint) dma_channel)->transfer_count;
+    const uint32_t position = (uint32_t) channel_position[channel];
+    if (taken <= position) {
+        return 0;
+    }
+    // number of samples of the channel in the ring and the index of the
+    // latest one in the sequence
+    const uint32_t available = (taken - position - 1) / channel_count + 1;
+    const uint32_t latest = position + (available - 1) * channel_count;
+    if (count > available) {
+        count = available;
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = ring[(latest - (uint32_t) (count - 1 - i) * channel_count)
+                      % RING_LENGTH];
+    }
+    return count;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2022-2024 AVSystem <avsystem@avsystem.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include <hardware/adc.h>
+
+#include "lm35_adc.h"
+
+/**
+ * Host backend: there is no background acquisition, so the samples are read
+ * from the ADC stand-in on demand. Feeding it a recorded trace with
+ * host_adc_set_source() runs the filters on real data.
+ */
+
+static uint acquired_channels;
+
+int lm35_adc_init(uint channel_mask, uint32_t sample_rate_hz) {
+    (void) sample_rate_hz;
+    acquired_channels = channel_mask;
+    return 0;
+}
+
+void lm35_adc_release(void) {
+    acquired_channels = 0;
+}
+
+size_t lm35_adc_get_latest(uint channel, uint16_t *out, size_t count) {
+    assert(out);
+    assert(count <= LM35_ADC_MAX_FETCH);
+
+    if (channel >= 32 || !(acquired_channels & (1u << channel))) {
+        return 0;
+    }
+    adc_select_input(channel);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = adc_read();
+    }
+    return count;
+}
@@ -18,6 +18,9 @@
 
 #include <anjay/dm.h>
 
+/**
+ * Installs the Temperature object and starts sampling the sensor from a job on
+ * the Anjay scheduler.
+ */
 void temperature_sensor_install(anjay_t *anjay);
-void temperature_sensor_update(anjay_t *anjay);
 void temperature_sensor_release(void);
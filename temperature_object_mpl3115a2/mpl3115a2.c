@@ -14,22 +14,43 @@
  * limitations under the License.
  */
 
-#include "FreeRTOS.h"
+#include <stdbool.h>
+
 #include "hardware/gpio.h"
 #include "hardware/i2c.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/sync.h"
 #include "pico/binary_info.h"
 #include "pico/stdlib.h"
-#include "semphr.h"
+
+#include <avsystem/commons/avs_log.h>
+
+#include "i2c_bus.h"
+#include "mpl3115a2.h"
+#include "sensor_sample.h"
 
 #ifndef i2c_default
 #    define i2c_default PICO_DEFAULT_I2C_INSTANCE
 #endif
 
+#if (MPL3115A2_FIFO_WATERMARK < 1) || (MPL3115A2_FIFO_WATERMARK > 31)
+#    error "Invalid MPL3115A2_FIFO_WATERMARK value"
+#endif
+
+#if (MPL3115A2_STEP_EXP < 0) || (MPL3115A2_STEP_EXP > 15)
+#    error "Invalid MPL3115A2_STEP_EXP value"
+#endif
+
 // 7-bit sensor i2c address
 #define MPL3115A2_I2C_ADDR (0x60)
 
-#define MPL3115A2_REG_OUT_T_MSB_ADDR (0x04)
+/* A full FIFO burst takes about 4 ms at 400 kHz */
+#define MPL3115A2_I2C_TIMEOUT_MS 50
+
+#define MPL3115A2_REG_F_STATUS_ADDR (0x00)
+#define MPL3115A2_REG_F_DATA_ADDR (0x01)
 #define MPL3115A2_REG_WHO_AM_I_ADDR (0x0C)
+#define MPL3115A2_REG_F_SETUP_ADDR (0x0F)
 #define MPL3115A2_REG_CTRLREG1_ADDR (0x26)
 
 #define MPL3115A2_CTRLREG1_OS0 (0x08)
@@ -41,83 +62,224 @@
     (MPL3115A2_CTRLREG1_OS0 | MPL3115A2_CTRLREG1_OS1 | MPL3115A2_CTRLREG1_OS2 \
      | MPL3115A2_CTRLREG1_SBYB)
 
-#define MUTEX_TIME_TO_WAIT (200 / portTICK_PERIOD_MS)
-
-static double temperature_sensor_data;
-static SemaphoreHandle_t mutex;
-
-int temperature_read_data(void) {
-    int retval = -1;
-    if (pdTRUE == xSemaphoreTake(mutex, MUTEX_TIME_TO_WAIT)) {
-        uint8_t reg = MPL3115A2_REG_OUT_T_MSB_ADDR;
-        uint8_t buf[2];
-
-        if ((i2c_write_blocking(i2c_default, MPL3115A2_I2C_ADDR, &reg, 1, true)
-             != 1)) {
-            goto finish;
-        }
-        if (i2c_read_blocking(i2c_default, MPL3115A2_I2C_ADDR, buf, 2, false)
-                != 2) {
-            goto finish;
-        }
-
-        int16_t t = (int16_t) (((uint16_t) buf[0]) << 8 | buf[1]);
-        temperature_sensor_data = ((float) t) / 256.f;
-        retval = 0;
-    finish:
-        xSemaphoreGive(mutex);
+/* FIFO in circular mode: the oldest sample is overwritten on overflow */
+#define MPL3115A2_F_SETUP_F_MODE_CIRCULAR (0x40)
+#define MPL3115A2_F_STATUS_F_OVF (0x80)
+#define MPL3115A2_F_STATUS_F_CNT_MASK (0x3F)
+
+/* CTRL_REG2 to CTRL_REG5, written in one transfer: acquisition step, INT1
+ * active low push-pull, FIFO interrupt enabled and routed to INT1 */
+#define MPL3115A2_CTRLREG3_CONFIG (0x00)
+#define MPL3115A2_CTRLREG4_INT_EN_FIFO (0x40)
+#define MPL3115A2_CTRLREG5_INT_CFG_FIFO (0x40)
+#define MPL3115A2_REG_CTRLREG2_ADDR (0x27)
+
+/* Each FIFO sample: 3 bytes of pressure, then 2 bytes of temperature */
+#define MPL3115A2_FIFO_SAMPLE_SIZE 5
+#define MPL3115A2_FIFO_SAMPLE_P_MSB 0
+#define MPL3115A2_FIFO_SAMPLE_T_MSB 3
+
+/* Pressure is unsigned Q18.2 pascals, left-aligned in 24 bits */
+#define MPL3115A2_PRESSURE_SHIFT 4
+#define MPL3115A2_MILLIPASCALS_PER_LSB 250
+
+#define MPL3115A2_STEP_US ((uint64_t) 1000000 << MPL3115A2_STEP_EXP)
+
+/* The first conversion starts when the sensor becomes active, and takes up to
+ * 512 ms at 128x oversampling */
+#define MPL3115A2_FIRST_SAMPLE_WAIT_US 1000000
+
+static sensor_sample_store_t temperature_sample;
+static sensor_sample_store_t pressure_sample;
+
+/* Set by the INT1 handler, which masks the interrupt until the FIFO has been
+ * drained, as the sensor keeps the line asserted until then. */
+static volatile bool fifo_pending;
+/* time_us_64() of the last drain; a missed interrupt is covered by draining
+ * anyway after the FIFO should have reached the watermark twice */
+static uint64_t last_drain_us;
+/* Core whose IO_IRQ_BANK0 handler runs int1_callback(). Each core has its own
+ * GPIO interrupt enable bits and gpio_set_irq_enabled() only changes those of
+ * the calling core, while the task reading the FIFO may run on either. */
+static uint int1_core;
+
+static void set_int1_enabled(bool enabled) {
+    io_irq_ctrl_hw_t *irq_ctrl = int1_core ? &iobank0_hw->proc1_irq_ctrl
+                                           : &iobank0_hw->proc0_irq_ctrl;
+    io_rw_32 *inte = &irq_ctrl->inte[MPL3115A2_INT_GPIO_PIN / 8];
+    const uint32_t events = (uint32_t) GPIO_IRQ_LEVEL_LOW
+                            << (4 * (MPL3115A2_INT_GPIO_PIN % 8));
+    if (enabled) {
+        hw_set_bits(inte, events);
+    } else {
+        hw_clear_bits(inte, events);
+    }
+}
+
+static void int1_callback(uint gpio, uint32_t event_mask) {
+    (void) event_mask;
+    if (gpio == MPL3115A2_INT_GPIO_PIN) {
+        set_int1_enabled(false);
+        fifo_pending = true;
     }
-    return retval;
 }
 
-int temperature_get_data(double *sensor_data) {
-    if (pdTRUE == xSemaphoreTake(mutex, MUTEX_TIME_TO_WAIT)) {
-        *sensor_data = temperature_sensor_data;
-        xSemaphoreGive(mutex);
+// the calling task sleeps while the bus transfers the data
+static int read_regs(uint8_t reg, uint8_t *buf, size_t len) {
+    return i2c_bus_transfer(MPL3115A2_I2C_ADDR, &reg, 1, buf, len,
+                            MPL3115A2_I2C_TIMEOUT_MS)
+                   ? -1
+                   : 0;
+}
+
+static int write_regs(const uint8_t *buf, size_t len) {
+    return i2c_bus_transfer(MPL3115A2_I2C_ADDR, buf, len, NULL, 0,
+                            MPL3115A2_I2C_TIMEOUT_MS)
+                   ? -1
+                   : 0;
+}
+
+static int drain_fifo(mpl3115a2_sample_t *out) {
+    uint8_t status;
+    // reading F_STATUS also clears the FIFO interrupt
+    if (read_regs(MPL3115A2_REG_F_STATUS_ADDR, &status, 1)) {
+        return -1;
+    }
+    if (status & MPL3115A2_F_STATUS_F_OVF) {
+        avs_log(mpl3115a2, DEBUG, "FIFO overflow, oldest samples lost");
+    }
+    const size_t count = status & MPL3115A2_F_STATUS_F_CNT_MASK;
+    if (!count || count > MPL3115A2_FIFO_SIZE) {
         return 0;
-    } else {
+    }
+
+    // the register pointer stays at F_DATA during a read, so a single burst
+    // returns all the samples
+    uint8_t buf[MPL3115A2_FIFO_SIZE * MPL3115A2_FIFO_SAMPLE_SIZE];
+    if (read_regs(MPL3115A2_REG_F_DATA_ADDR, buf,
+                  count * MPL3115A2_FIFO_SAMPLE_SIZE)) {
         return -1;
     }
+
+    // the newest sample was taken within the last step
+    const uint64_t now_us = time_us_64();
+    for (size_t i = 0; i < count; i++) {
+        const uint64_t age_us = (count - 1 - i) * MPL3115A2_STEP_US;
+        const uint8_t *sample = &buf[i * MPL3115A2_FIFO_SAMPLE_SIZE];
+        const uint8_t *p = &sample[MPL3115A2_FIFO_SAMPLE_P_MSB];
+        const uint8_t *t = &sample[MPL3115A2_FIFO_SAMPLE_T_MSB];
+        const uint32_t raw_p = ((uint32_t) p[0] << 16 | (uint32_t) p[1] << 8
+                                | p[2])
+                               >> MPL3115A2_PRESSURE_SHIFT;
+        // signed degrees in the MSB and fractional degrees in the upper
+        // nibble of the LSB, i.e. Q8.8 with 4 bits of precision
+        const int16_t raw = (int16_t) (((uint16_t) t[0]) << 8 | t[1]);
+        out[i] = (mpl3115a2_sample_t) {
+            .timestamp_us = now_us > age_us ? now_us - age_us : 0,
+            .millicelsius = (int32_t) raw * 1000 / 256,
+            .millipascals = (int32_t) (raw_p * MPL3115A2_MILLIPASCALS_PER_LSB)
+        };
+    }
+    sensor_sample_store_put(&temperature_sample, out[count - 1].millicelsius);
+    sensor_sample_store_put(&pressure_sample, out[count - 1].millipascals);
+    return (int) count;
+}
+
+int mpl3115a2_read_fifo(mpl3115a2_sample_t *out) {
+    const uint64_t now_us = time_us_64();
+    if (!fifo_pending
+            && now_us - last_drain_us
+                           < 2 * MPL3115A2_FIFO_WATERMARK * MPL3115A2_STEP_US) {
+        return 0;
+    }
+
+    fifo_pending = false;
+    last_drain_us = now_us;
+    const int result = drain_fifo(out);
+    if (result < 0) {
+        sensor_sample_store_put_error(&temperature_sample);
+        sensor_sample_store_put_error(&pressure_sample);
+    }
+    set_int1_enabled(true);
+    return result;
+}
+
+int temperature_get_data(int32_t *out_millicelsius) {
+    return sensor_sample_store_get_value(&temperature_sample,
+                                         out_millicelsius);
+}
+
+int pressure_get_data(int32_t *out_millipascals) {
+    return sensor_sample_store_get_value(&pressure_sample, out_millipascals);
 }
 
 int mpl3115a2_init(void) {
     // use default I2C0 at 400kHz, I2C is active low
-    i2c_init(i2c_default, 400000);
+    if (i2c_bus_init(i2c_default, 400000)) {
+        return -1;
+    }
     gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
     gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
 
+    gpio_init(MPL3115A2_INT_GPIO_PIN);
+    gpio_set_dir(MPL3115A2_INT_GPIO_PIN, GPIO_IN);
+    gpio_pull_up(MPL3115A2_INT_GPIO_PIN);
+
     // add program information for picotool
     bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN,
                                PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
 
     // verify chip's identity
-    uint8_t reg = MPL3115A2_REG_WHO_AM_I_ADDR;
     uint8_t who_am_i;
-    if (i2c_write_blocking(i2c_default, MPL3115A2_I2C_ADDR, &reg, 1, true)
-            != 1) {
-        return -1;
-    }
-
-    if (i2c_read_blocking(i2c_default, MPL3115A2_I2C_ADDR, &who_am_i, 1, false)
-                    != 1
-            && who_am_i != MPL3115A2_WHO_AM_I_VAL) {
+    if (read_regs(MPL3115A2_REG_WHO_AM_I_ADDR, &who_am_i, 1)
+            || who_am_i != MPL3115A2_WHO_AM_I_VAL) {
         return -1;
     }
 
-    // set device active
-    uint8_t buf[] = { MPL3115A2_REG_CTRLREG1_ADDR, MPL3115A2_CTRLREG1_CONFIG };
-    if (i2c_write_blocking(i2c_default, MPL3115A2_I2C_ADDR, buf, 2, false)
-            != 2) {
+    // the FIFO and interrupts may only be configured in standby
+    const uint8_t standby[] = { MPL3115A2_REG_CTRLREG1_ADDR, 0 };
+    const uint8_t fifo_setup[] = { MPL3115A2_REG_F_SETUP_ADDR,
+                                   MPL3115A2_F_SETUP_F_MODE_CIRCULAR
+                                           | MPL3115A2_FIFO_WATERMARK };
+    const uint8_t ctrl[] = { MPL3115A2_REG_CTRLREG2_ADDR, MPL3115A2_STEP_EXP,
+                             MPL3115A2_CTRLREG3_CONFIG,
+                             MPL3115A2_CTRLREG4_INT_EN_FIFO,
+                             MPL3115A2_CTRLREG5_INT_CFG_FIFO };
+    const uint8_t active[] = { MPL3115A2_REG_CTRLREG1_ADDR,
+                               MPL3115A2_CTRLREG1_CONFIG };
+    if (write_regs(standby, sizeof(standby))
+            || write_regs(fifo_setup, sizeof(fifo_setup))
+            || write_regs(ctrl, sizeof(ctrl))
+            || write_regs(active, sizeof(active))) {
         return -1;
     }
 
-    mutex = xSemaphoreCreateMutex();
+    sensor_sample_store_init(&temperature_sample);
+    sensor_sample_store_init(&pressure_sample);
+    fifo_pending = false;
 
+    // wait for the first sample, so that a value is available right away
+    mpl3115a2_sample_t samples[MPL3115A2_FIFO_SIZE];
+    const uint64_t deadline_us = time_us_64() + MPL3115A2_FIRST_SAMPLE_WAIT_US;
+    while (drain_fifo(samples) == 0 && time_us_64() < deadline_us) {
+        sleep_ms(100);
+    }
+    last_drain_us = time_us_64();
+    // the handler is installed on the current core; with interrupts masked,
+    // the task cannot be moved to the other one in the meantime
+    const uint32_t irq_status = save_and_disable_interrupts();
+    int1_core = get_core_num();
+    gpio_set_irq_enabled_with_callback(MPL3115A2_INT_GPIO_PIN,
+                                       GPIO_IRQ_LEVEL_LOW, true, int1_callback);
+    restore_interrupts(irq_status);
     return 0;
 }
 
 int mpl3115a2_release(void) {
-    i2c_deinit(i2c_default);
+    set_int1_enabled(false);
+    gpio_deinit(MPL3115A2_INT_GPIO_PIN);
+    i2c_bus_release();
+    return 0;
 }
@@ -16,7 +16,63 @@
 
 #pragma once
 
-int temperature_read_data(void);
-int temperature_get_data(double *sensor_data);
+#include <stddef.h>
+#include <stdint.h>
+
+/* Pico GPIO pin where the INT1 output of the sensor is connected */
+#ifndef MPL3115A2_INT_GPIO_PIN
+#    define MPL3115A2_INT_GPIO_PIN 6
+#endif
+
+/* The sensor takes a sample every 2^MPL3115A2_STEP_EXP seconds, 0 to 15 */
+#ifndef MPL3115A2_STEP_EXP
+#    define MPL3115A2_STEP_EXP 0
+#endif
+
+/* Number of samples in the FIFO that raise the interrupt, 1 to 31; 1 makes
+ * it a data-ready interrupt */
+#ifndef MPL3115A2_FIFO_WATERMARK
+#    define MPL3115A2_FIFO_WATERMARK 8
+#endif
+
+#define MPL3115A2_FIFO_SIZE 32
+
+typedef struct {
+    /* time_us_64() at which the sample was taken, estimated from the step */
+    uint64_t timestamp_us;
+    int32_t millicelsius;
+    /* thousandths of a pascal, with 0.25 Pa resolution */
+    int32_t millipascals;
+} mpl3115a2_sample_t;
+
+/**
+ * Configures the sensor for autonomous acquisition into its FIFO and waits
+ * for the first sample.
+ */
 int mpl3115a2_init(void);
 int mpl3115a2_release(void);
+
+/**
+ * If the FIFO interrupt has fired, drains all samples from the FIFO in a
+ * single burst read and stores the latest one for temperature_get_data() and
+ * pressure_get_data(). Every sample carries both quantities, so they cost a
+ * single read.
+ * Otherwise, does not access the bus.
+ *
+ * out must have room for MPL3115A2_FIFO_SIZE samples, which are written
+ * oldest first. Returns the number of samples read, or a negative value on
+ * a bus error.
+ */
+int mpl3115a2_read_fifo(mpl3115a2_sample_t *out);
+
+/**
+ * Returns the latest stored sample, in millidegrees Celsius, without accessing
+ * the bus.
+ */
+int temperature_get_data(int32_t *out_millicelsius);
+
+/**
+ * Returns the latest stored pressure sample, in thousandths of a pascal,
+ * without accessing the bus.
+ */
+int pressure_get_data(int32_t *out_millipascals);
@@ -24,21 +24,139 @@
 #include <avsystem/commons/avs_log.h>
 
 #include "mpl3115a2.h"
+#include "sensor_change_filter.h"
+#include "sensor_history.h"
+#include "sensor_sample.h"
+#include "sensor_sampling.h"
+#include "sensor_stats_object.h"
 #include "temperature_sensor.h"
 
+#define TEMPERATURE_OID 3303
+#define BAROMETER_OID 3315
+#define SENSOR_VALUE_RID 5700
+
+/* Changes smaller than this, in millidegrees Celsius, are treated as noise */
+#ifndef TEMPERATURE_SENSOR_DEADBAND_MC
+#    define TEMPERATURE_SENSOR_DEADBAND_MC 125
+#endif
+
+/* Changes smaller than this, in thousandths of a pascal, are treated as
+ * noise */
+#ifndef BAROMETER_DEADBAND_MILLIPASCALS
+#    define BAROMETER_DEADBAND_MILLIPASCALS 2000
+#endif
+
+/* Number of samples uploaded in a single LwM2M Send message, 0 to disable */
+#ifndef TEMPERATURE_SENSOR_HISTORY_SIZE
+#    define TEMPERATURE_SENSOR_HISTORY_SIZE 100
+#endif
+
+/* Keep samples that could not be sent in flash, see sensor_flash_log.h */
+#ifndef TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+#    define TEMPERATURE_SENSOR_FLASH_LOG_ENABLED 1
+#endif
+
+/* Maximum time a sample waits in the history before it is sent */
+#ifndef TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS
+#    define TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS 300000
+#endif
+
+/* Sampling period while Sensor Value is not observed, 0 to stop sampling */
+#ifndef TEMPERATURE_SENSOR_IDLE_PERIOD_MS
+#    if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+#        define TEMPERATURE_SENSOR_IDLE_PERIOD_MS 10000
+#    else
+#        define TEMPERATURE_SENSOR_IDLE_PERIOD_MS 0
+#    endif
+#endif
+
+#define SERVER_SSID 1
+
+static const anjay_dm_object_def_t **STATS_OBJ;
+static sensor_change_filter_t change_filter;
+static sensor_change_filter_t barometer_change_filter;
+/* the barometer is optional, see temperature_sensor_install() */
+static bool barometer_installed;
+static sensor_sampling_t sampling;
+
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+static sensor_history_entry_t history_entries[TEMPERATURE_SENSOR_HISTORY_SIZE];
+static sensor_history_t history;
+#    if TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+static sensor_flash_log_t flash_log;
+#    endif // TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+
 static int
 temperature_sensor_get_value(anjay_iid_t iid, void *_ctx, double *value) {
     (void) iid;
     (void) _ctx;
     assert(value);
 
-    double read_value;
-    if (!temperature_read_data() && !temperature_get_data(&read_value)) {
-        *value = read_value;
-        return 0;
-    } else {
+    // only returns the latest sample taken by the sampling job; if sampling
+    // has stopped because nobody observed the value, resume it
+    sensor_sampling_kick(&sampling);
+    int32_t millicelsius;
+    if (temperature_get_data(&millicelsius)) {
         return -1;
     }
+    *value = sensor_sample_to_double(millicelsius);
+    return 0;
+}
+
+static int
+barometer_get_value(anjay_iid_t iid, void *_ctx, double *value) {
+    (void) iid;
+    (void) _ctx;
+    assert(value);
+
+    sensor_sampling_kick(&sampling);
+    int32_t millipascals;
+    if (pressure_get_data(&millipascals)) {
+        return -1;
+    }
+    *value = sensor_sample_to_double(millipascals);
+    return 0;
+}
+
+static int32_t sample_sensors(anjay_t *anjay) {
+    mpl3115a2_sample_t samples[MPL3115A2_FIFO_SIZE];
+    const int count = mpl3115a2_read_fifo(samples);
+    if (count <= 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+        sensor_history_add_at(&history, 0, samples[i].millicelsius,
+                              samples[i].timestamp_us);
+        if (barometer_installed) {
+            sensor_history_add_object_at(&history, BAROMETER_OID, 0,
+                                         samples[i].millipascals,
+                                         samples[i].timestamp_us);
+        }
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+        sensor_stats_object_add_sample(anjay, STATS_OBJ, 0,
+                                       samples[i].millicelsius);
+    }
+
+    // pass the latest samples to Anjay only if they may trigger a
+    // notification
+    const mpl3115a2_sample_t *latest = &samples[count - 1];
+    if (sensor_change_filter_check_resource(&change_filter, anjay,
+                                            TEMPERATURE_OID, 0,
+                                            SENSOR_VALUE_RID,
+                                            latest->millicelsius)) {
+        anjay_ipso_basic_sensor_update(anjay, TEMPERATURE_OID, 0);
+    }
+    if (barometer_installed
+            && sensor_change_filter_check_resource(&barometer_change_filter,
+                                                   anjay, BAROMETER_OID, 0,
+                                                   SENSOR_VALUE_RID,
+                                                   latest->millipascals)) {
+        anjay_ipso_basic_sensor_update(anjay, BAROMETER_OID, 0);
+    }
+    return 0;
 }
 
 void temperature_sensor_install(anjay_t *anjay) {
@@ -49,7 +167,13 @@ void temperature_sensor_install(anjay_t *anjay) {
         return;
     }
 
-    if (anjay_ipso_basic_sensor_install(anjay, 3303, 1)) {
+    // the instances read their initial values, taken by mpl3115a2_init(),
+    // when added
+    sensor_change_filter_init(&change_filter, TEMPERATURE_SENSOR_DEADBAND_MC);
+    sensor_change_filter_init(&barometer_change_filter,
+                              BAROMETER_DEADBAND_MILLIPASCALS);
+
+    if (anjay_ipso_basic_sensor_install(anjay, TEMPERATURE_OID, 1)) {
         avs_log(ipso_object,
                 WARNING,
                 "Object: Temperature sensor could not be installed");
@@ -58,7 +182,7 @@ void temperature_sensor_install(anjay_t *anjay) {
 
     if (anjay_ipso_basic_sensor_instance_add(
                 anjay,
-                3303,
+                TEMPERATURE_OID,
                 0,
                 (anjay_ipso_basic_sensor_impl_t) {
                     .unit = "Cel",
@@ -69,13 +193,78 @@ void temperature_sensor_install(anjay_t *anjay) {
         avs_log(ipso_object,
                 WARNING,
                 "Instance of Temperature sensor object could not be added");
+        return;
     }
-}
 
-void temperature_sensor_update(anjay_t *anjay) {
-    anjay_ipso_basic_sensor_update(anjay, 3303, 0);
+    // the barometer is optional, the temperature sensor works without it
+    barometer_installed =
+            !anjay_ipso_basic_sensor_install(anjay, BAROMETER_OID, 1)
+            && !anjay_ipso_basic_sensor_instance_add(
+                       anjay,
+                       BAROMETER_OID,
+                       0,
+                       (anjay_ipso_basic_sensor_impl_t) {
+                           .unit = "Pa",
+                           .min_range_value = 20000,
+                           .max_range_value = 110000,
+                           .get_value = barometer_get_value
+                       });
+    if (!barometer_installed) {
+        avs_log(ipso_object,
+                WARNING,
+                "Object: Barometer could not be installed");
+    }
+
+    STATS_OBJ = sensor_stats_object_create(1);
+    if (!STATS_OBJ || anjay_register_object(anjay, STATS_OBJ)) {
+        avs_log(ipso_object,
+                WARNING,
+                "Object: Sensor Statistics could not be installed");
+        sensor_stats_object_release(STATS_OBJ);
+        STATS_OBJ = NULL;
+    }
+
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    history = (sensor_history_t) {
+        .anjay = anjay,
+        .ssid = SERVER_SSID,
+        .oid = TEMPERATURE_OID,
+        .rid = SENSOR_VALUE_RID,
+        .flush_interval_ms = TEMPERATURE_SENSOR_HISTORY_FLUSH_INTERVAL_MS,
+        .entries = history_entries,
+        .capacity = TEMPERATURE_SENSOR_HISTORY_SIZE
+    };
+#    if TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+    if (sensor_flash_log_open(&flash_log, SENSOR_FLASH_LOG_OFFSET,
+                              SENSOR_FLASH_LOG_SIZE)) {
+        avs_log(ipso_object, WARNING,
+                "Flash log could not be opened, samples will not be stored");
+    } else {
+        history.log = &flash_log;
+    }
+#    endif // TEMPERATURE_SENSOR_FLASH_LOG_ENABLED
+    sensor_history_init(&history);
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+
+    sampling = (sensor_sampling_t) {
+        .anjay = anjay,
+        .oid = TEMPERATURE_OID,
+        .secondary_oid = barometer_installed ? BAROMETER_OID : 0,
+        .instance_count = 1,
+        .rid = SENSOR_VALUE_RID,
+        .idle_period_ms = TEMPERATURE_SENSOR_IDLE_PERIOD_MS,
+        .sample = sample_sensors
+    };
+    sensor_sampling_start(&sampling);
 }
 
 void temperature_sensor_release(void) {
+    sensor_sampling_stop(&sampling);
+    sampling.anjay = NULL;
+#if TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    sensor_history_cleanup(&history);
+#endif // TEMPERATURE_SENSOR_HISTORY_SIZE > 0
+    sensor_stats_object_release(STATS_OBJ);
+    STATS_OBJ = NULL;
     mpl3115a2_release();
 }